@@ -0,0 +1,277 @@
+// Runs many headless instances of an app on a pool of worker threads and writes a summary.
+//
+// The app is linked unchanged with its main renamed to flipper_app_main (see CMakeLists.txt).
+// Every instance gets its own FLIPPER_CTX, made current for the worker thread while the
+// app's main loop runs on it.
+
+#define SDL_MAIN_HANDLED
+
+#include <SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "flipper.h"
+
+#define MAX_INPUTS 256
+
+int flipper_app_main();
+
+typedef struct JOB JOB;
+struct JOB {
+    uint64_t seed;
+    const char* input;   // input log or NULL
+    const char* golden;  // frame hash stream to compare with or NULL
+
+    int result;
+    int frames;
+    int score;
+    int exit_reason;
+    double ms;
+};
+
+typedef struct BATCH BATCH;
+struct BATCH {
+    JOB* jobs;
+    int num_jobs;
+    int frame_limit;
+    SDL_atomic_t next_job;
+};
+
+static const char* exit_reason_names[] = { "none", "user", "frame_limit", "replay_end",
+                                            "golden_mismatch" };
+
+static void run_job(BATCH* batch, JOB* job) {
+    uint64_t start = SDL_GetPerformanceCounter();
+
+    FLIPPER_CTX* ctx = flipper_ctx_create(FL_INIT_HEADLESS | FL_INIT_VIRTUAL_CLOCK);
+    if (!ctx) {
+        job->result = -1;
+        return;
+    }
+
+    if ((job->input && !flipper_ctx_input_replay(ctx, job->input)) ||
+        (job->golden && !flipper_ctx_hash_check(ctx, job->golden))) {
+        job->result = -1;
+        flipper_ctx_destroy(ctx);
+        return;
+    }
+    // replays and golden runs use the seed recorded with them, the summary shows it
+    if (!job->input && !job->golden)
+        flipper_ctx_random_seed(ctx, job->seed);
+    job->seed = flipper_ctx_random_get_seed(ctx);
+    flipper_ctx_set_frame_limit(ctx, batch->frame_limit);
+
+    flipper_ctx_make_current(ctx);
+    job->result = flipper_app_main();
+    flipper_ctx_make_current(NULL);
+
+    job->frames = flipper_ctx_get_frame_count(ctx);
+    job->score = flipper_ctx_get_score(ctx);
+    job->exit_reason = flipper_ctx_get_exit_reason(ctx);
+    if (job->golden && flipper_ctx_hash_failed(ctx) && job->result == 0)
+        job->result = 1;
+    flipper_ctx_destroy(ctx);
+
+    uint64_t end = SDL_GetPerformanceCounter();
+    job->ms = (double)(end - start) * 1000.0 / (double)SDL_GetPerformanceFrequency();
+}
+
+static int worker(void* data) {
+    BATCH* batch = (BATCH*)data;
+    while (true) {
+        int i = SDL_AtomicAdd(&batch->next_job, 1);
+        if (i >= batch->num_jobs)
+            break;
+        run_job(batch, &batch->jobs[i]);
+    }
+    return 0;
+}
+
+// quoted as in RFC 4180, so paths with commas or quotes keep the columns
+static void write_csv_string(FILE* f, const char* s) {
+    fputc('"', f);
+    for (; *s; s++) {
+        if (*s == '"')
+            fputc('"', f);
+        fputc(*s, f);
+    }
+    fputc('"', f);
+}
+
+static void write_csv(FILE* f, BATCH* batch) {
+    fprintf(f, "instance,seed,input,result,frames,score,exit,ms\n");
+    for (int i = 0; i < batch->num_jobs; i++) {
+        JOB* job = &batch->jobs[i];
+        fprintf(f, "%d,%llu,", i, (unsigned long long)job->seed);
+        write_csv_string(f, job->input ? job->input : "");
+        fprintf(f, ",%d,%d,%d,%s,%.3f\n", job->result, job->frames, job->score,
+                exit_reason_names[job->exit_reason], job->ms);
+    }
+}
+
+static void write_json_string(FILE* f, const char* s) {
+    fputc('"', f);
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\')
+            fprintf(f, "\\%c", c);
+        else if (c < 0x20)
+            fprintf(f, "\\u%04x", c);
+        else
+            fputc(c, f);
+    }
+    fputc('"', f);
+}
+
+static void write_json(FILE* f, BATCH* batch) {
+    fprintf(f, "[\n");
+    for (int i = 0; i < batch->num_jobs; i++) {
+        JOB* job = &batch->jobs[i];
+        fprintf(f, "  {\"instance\": %d, \"seed\": %llu, \"input\": ", i,
+                (unsigned long long)job->seed);
+        write_json_string(f, job->input ? job->input : "");
+        fprintf(f,
+                ", \"result\": %d, \"frames\": %d, \"score\": %d, \"exit\": \"%s\", "
+                "\"ms\": %.3f}%s\n",
+                job->result, job->frames, job->score, exit_reason_names[job->exit_reason],
+                job->ms, i + 1 < batch->num_jobs ? "," : "");
+    }
+    fprintf(f, "]\n");
+}
+
+static void usage(const char* name) {
+    printf("usage: %s [options]\n", name);
+    printf("  -n N       number of instances (default 1)\n");
+    printf("  -j N       worker threads (default number of cpus)\n");
+    printf("  -s SEED    random seed of the first instance, instance i uses SEED+i (default 1)\n");
+    printf("             instances replaying an input log use the seed recorded in it\n");
+    printf("  -f FRAMES  frame limit per instance (default 15000, 0 = none)\n");
+    printf("  -i FILE    input log, can be repeated, instance i replays log i %% count\n");
+    printf("  -g FILE    frame hash file, can be repeated, instance i checks file i %% count\n");
+    printf("             and uses the seed recorded in it\n");
+    printf("  -o FILE    write the summary to FILE, JSON if it ends with .json, else CSV\n");
+}
+
+int main(int argc, char** argv) {
+    int num_jobs = 1;
+    int num_threads = SDL_GetCPUCount();
+    uint64_t seed = 1;
+    int frame_limit = 15000;
+    const char* inputs[MAX_INPUTS];
+    int num_inputs = 0;
+    const char* goldens[MAX_INPUTS];
+    int num_goldens = 0;
+    const char* output = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (arg[0] != '-' || !arg[1] || arg[2] || !value) {
+            usage(argv[0]);
+            return 1;
+        }
+        i++;
+
+        switch (arg[1]) {
+            case 'n': num_jobs = atoi(value); break;
+            case 'j': num_threads = atoi(value); break;
+            case 's': seed = strtoull(value, NULL, 0); break;
+            case 'f': frame_limit = atoi(value); break;
+            case 'o': output = value; break;
+            case 'i':
+                if (num_inputs == MAX_INPUTS) {
+                    printf("too many input logs\n");
+                    return 1;
+                }
+                inputs[num_inputs++] = value;
+                break;
+            case 'g':
+                if (num_goldens == MAX_INPUTS) {
+                    printf("too many frame hash files\n");
+                    return 1;
+                }
+                goldens[num_goldens++] = value;
+                break;
+            default: usage(argv[0]); return 1;
+        }
+    }
+    if (num_jobs < 1)
+        num_jobs = 1;
+    if (num_threads < 1)
+        num_threads = 1;
+    if (num_threads > num_jobs)
+        num_threads = num_jobs;
+
+    BATCH batch;
+    batch.num_jobs = num_jobs;
+    batch.frame_limit = frame_limit;
+    SDL_AtomicSet(&batch.next_job, 0);
+    batch.jobs = (JOB*)calloc(num_jobs, sizeof(JOB));
+    if (!batch.jobs) {
+        printf("calloc jobs\n");
+        return 1;
+    }
+    for (int i = 0; i < num_jobs; i++) {
+        batch.jobs[i].seed = seed + i;
+        batch.jobs[i].input = num_inputs ? inputs[i % num_inputs] : NULL;
+        batch.jobs[i].golden = num_goldens ? goldens[i % num_goldens] : NULL;
+    }
+
+    uint64_t start = SDL_GetPerformanceCounter();
+
+    SDL_Thread** threads = (SDL_Thread**)calloc(num_threads, sizeof(SDL_Thread*));
+    int started = 0;
+    for (int i = 0; threads && i < num_threads; i++) {
+        threads[started] = SDL_CreateThread(worker, "batch", &batch);
+        if (!threads[started]) {
+            printf("SDL_CreateThread: %s\n", SDL_GetError());
+            break;
+        }
+        started++;
+    }
+    // without any worker the jobs run on this thread
+    if (started == 0) {
+        worker(&batch);
+        started = 1;
+    }
+    for (int i = 0; threads && i < started; i++) {
+        if (threads[i])
+            SDL_WaitThread(threads[i], NULL);
+    }
+    free(threads);
+    num_threads = started;
+
+    uint64_t end = SDL_GetPerformanceCounter();
+    double seconds = (double)(end - start) / (double)SDL_GetPerformanceFrequency();
+
+    long long total_frames = 0;
+    int failed = 0;
+    for (int i = 0; i < num_jobs; i++) {
+        total_frames += batch.jobs[i].frames;
+        if (batch.jobs[i].result != 0)
+            failed++;
+    }
+
+    FILE* f = stdout;
+    if (output) {
+        f = fopen(output, "w");
+        if (!f) {
+            printf("can't create %s\n", output);
+            return 1;
+        }
+    }
+    size_t len = output ? strlen(output) : 0;
+    if (len >= 5 && strcmp(output + len - 5, ".json") == 0)
+        write_json(f, &batch);
+    else
+        write_csv(f, &batch);
+    if (f != stdout)
+        fclose(f);
+
+    fprintf(stderr, "%d instances on %d threads: %.3f s, %.0f frames/s, %d failed\n", num_jobs,
+            num_threads, seconds, total_frames / seconds, failed);
+
+    free(batch.jobs);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,112 @@
+// Microbenchmark for the 1bpp -> ARGB expansion done in flipper_lcd_update, for every layout.
+// usage: bench_expand [frames]
+
+#define SDL_MAIN_HANDLED
+
+#include <SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "flipper.h"
+#include "flipper_expand.h"
+
+#define COLOR_FG 0xff363636
+#define COLOR_BG 0xfffea652
+
+#define LCD_SIZE (FL_LCD_PAGES * FL_LCD_WIDTH)
+#define NUM_PIXELS (FL_LCD_WIDTH * FL_LCD_HEIGHT)
+
+// the straightforward per pixel loops the kernels are measured against
+static void expand_reference(uint32_t* dst, int dst_pitch, const uint8_t* lcd, int pages,
+                             uint32_t fg, uint32_t bg) {
+    for (int y = 0; y < pages * 8; y++) {
+        for (int x = 0; x < FL_LCD_WIDTH; x++) {
+            bool set = (lcd[(y >> 3) * FL_LCD_WIDTH + x] >> (y & 7)) & 1;
+            dst[y * dst_pitch + x] = set ? fg : bg;
+        }
+    }
+}
+
+static void expand_reference_2x(uint32_t* dst, int dst_pitch, const uint8_t* lcd, int pages,
+                                uint32_t fg, uint32_t bg) {
+    for (int y = 0; y < pages * 16; y++) {
+        for (int x = 0; x < FL_LCD_WIDTH * 2; x++) {
+            bool set = (lcd[(y >> 4) * FL_LCD_WIDTH + x / 2] >> ((y / 2) & 7)) & 1;
+            dst[y * dst_pitch + x] = set ? fg : bg;
+        }
+    }
+}
+
+static void expand_reference_2x_rotated(uint32_t* dst, int dst_pitch, const uint8_t* lcd,
+                                        int pages, uint32_t fg, uint32_t bg) {
+    for (int y = 0; y < FL_LCD_WIDTH * 2; y++) {
+        for (int x = 0; x < pages * 16; x++) {
+            bool set = (lcd[(x >> 4) * FL_LCD_WIDTH + y / 2] >> ((x / 2) & 7)) & 1;
+            dst[y * dst_pitch + x] = set ? fg : bg;
+        }
+    }
+}
+
+static const FLIPPER_EXPAND_FUNC references[FLIPPER_EXPAND_LAYOUT_COUNT] = {
+    expand_reference, expand_reference_2x, expand_reference_2x_rotated
+};
+
+// dst row pitch of each layout for a full frame
+static const int pitches[FLIPPER_EXPAND_LAYOUT_COUNT] = { FL_LCD_WIDTH, FL_LCD_WIDTH * 2,
+                                                          FL_LCD_HEIGHT * 2 };
+
+static double run(FLIPPER_EXPAND_FUNC f, int pitch, const uint8_t* lcd, uint32_t* dst,
+                  int frames) {
+    uint64_t start = SDL_GetPerformanceCounter();
+    for (int i = 0; i < frames; i++) {
+        f(dst, pitch, lcd, FL_LCD_PAGES, COLOR_FG, COLOR_BG);
+    }
+    uint64_t end = SDL_GetPerformanceCounter();
+    return (double)(end - start) * 1e9 / (double)SDL_GetPerformanceFrequency() / frames;
+}
+
+int main(int argc, char** argv) {
+    int frames = argc > 1 ? atoi(argv[1]) : 200000;
+    if (frames <= 0)
+        frames = 1;
+
+    uint8_t lcd[LCD_SIZE];
+    srand(1);
+    for (int i = 0; i < LCD_SIZE; i++) {
+        lcd[i] = (uint8_t)rand();
+    }
+
+    for (int l = 0; l < FLIPPER_EXPAND_LAYOUT_COUNT; l++) {
+        int pitch = pitches[l];
+        size_t size = (l == FLIPPER_EXPAND_1X ? NUM_PIXELS : NUM_PIXELS * 4) * sizeof(uint32_t);
+        static uint32_t expected[NUM_PIXELS * 4];
+        static uint32_t pixels[NUM_PIXELS * 4];
+        references[l](expected, pitch, lcd, FL_LCD_PAGES, COLOR_FG, COLOR_BG);
+
+        printf("%s:\n", flipper_expand_layout_name(l));
+        double ref_ns = run(references[l], pitch, lcd, pixels, frames);
+        printf("  %-10s %10.1f ns/frame %8.2f GB/s\n", "reference", ref_ns, size / ref_ns);
+
+        for (int k = 0; k < FLIPPER_EXPAND_COUNT; k++) {
+            FLIPPER_EXPAND_FUNC f = flipper_expand_kernel(k, l);
+            if (!f) {
+                printf("  %-10s not supported\n", flipper_expand_name(k));
+                continue;
+            }
+
+            memset(pixels, 0, size);
+            f(pixels, pitch, lcd, FL_LCD_PAGES, COLOR_FG, COLOR_BG);
+            if (memcmp(pixels, expected, size) != 0) {
+                printf("  %-10s output mismatch\n", flipper_expand_name(k));
+                return 1;
+            }
+
+            double ns = run(f, pitch, lcd, pixels, frames);
+            printf("  %-10s %10.1f ns/frame %8.2f GB/s %6.1fx\n", flipper_expand_name(k), ns,
+                   size / ns, ref_ns / ns);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,93 @@
+// Compares the render backends on the whole flipper_lcd_update path with a real window.
+// usage: bench_render [frames]
+//
+// Run from the directory containing img/. Without a display use SDL_VIDEODRIVER=offscreen,
+// the accelerated backends then fall back to software.
+
+#define SDL_MAIN_HANDLED
+
+#include <SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "flipper.h"
+#include "flipper_ctx.h"
+
+typedef struct BACKEND BACKEND;
+struct BACKEND {
+    const char* name;
+    int flags;
+};
+
+static const BACKEND backends[] = {
+    { "software", 0 },
+    { "accelerated", FL_INIT_ACCELERATED },
+    { "accelerated+vsync", FL_INIT_ACCELERATED | FL_INIT_VSYNC },
+};
+
+static const int report_phases[] = { FL_PHASE_UPLOAD, FL_PHASE_HIGHLIGHT, FL_PHASE_BACKGROUND,
+                                     FL_PHASE_PRESENT };
+
+// a 32x32 square moving across the lcd, so a few pages change every frame
+static void draw_frame(FLIPPER_CTX* ctx, int frame) {
+    flipper_ctx_pixel_reset(ctx);
+    int left = frame % (FL_LCD_WIDTH - 32);
+    int top = frame / 2 % (FL_LCD_HEIGHT - 32);
+    for (int y = top; y < top + 32; y++) {
+        for (int x = left; x < left + 32; x++) {
+            flipper_ctx_pixel_set(ctx, x, y);
+        }
+    }
+}
+
+static bool run(const BACKEND* backend, bool rotate, int frames) {
+    int flags = backend->flags | FL_INIT_STATS | (rotate ? FL_INIT_SIMULATOR_ROTATE : 0);
+    FLIPPER_CTX* ctx = flipper_ctx_create(flags);
+    if (!ctx)
+        return false;
+
+    SDL_RendererInfo info;
+    const char* renderer = "unknown";
+    if (SDL_GetRendererInfo(ctx->renderer, &info) == 0)
+        renderer = info.name;
+
+    uint64_t start = SDL_GetPerformanceCounter();
+    for (int i = 0; i < frames; i++) {
+        if (i % 50 == 0)
+            flipper_ctx_gpio_set(ctx, FL_GPIO_BUTTON_UP + i / 50 % 6);
+        draw_frame(ctx, i);
+        flipper_ctx_lcd_update(ctx);
+        SDL_PumpEvents();
+    }
+    uint64_t end = SDL_GetPerformanceCounter();
+    double seconds = (double)(end - start) / (double)SDL_GetPerformanceFrequency();
+
+    printf("%-18s %-7s %-10s %9.0f frames/s", backend->name, rotate ? "rotated" : "normal",
+           renderer, frames / seconds);
+    for (size_t i = 0; i < sizeof(report_phases) / sizeof(report_phases[0]); i++) {
+        FLIPPER_PHASE_STATS phase;
+        if (flipper_ctx_stats_get(ctx, report_phases[i], &phase))
+            printf("  %s p50 %u us", phase.name, phase.p50_us);
+    }
+    printf("\n");
+
+    flipper_ctx_destroy(ctx);
+    return true;
+}
+
+int main(int argc, char** argv) {
+    int frames = argc > 1 ? atoi(argv[1]) : 600;
+    if (frames <= 0)
+        frames = 1;
+
+    for (size_t b = 0; b < sizeof(backends) / sizeof(backends[0]); b++) {
+        for (int rotate = 0; rotate < 2; rotate++) {
+            if (!run(&backends[b], rotate, frames)) {
+                printf("%s: can't create a window\n", backends[b].name);
+                return 1;
+            }
+        }
+    }
+
+    return 0;
+}
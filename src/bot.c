@@ -0,0 +1,100 @@
+// Plays tetris games with the placement search and reports score and search speed.
+// usage: tetris_bot [options]
+//
+// Pieces come from flipper_random of a headless instance, so a seed gives the same games.
+
+#define SDL_MAIN_HANDLED
+
+#include <SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "flipper.h"
+#include "tetris_bot.h"
+
+static void usage(const char* name) {
+    printf("usage: %s [options]\n", name);
+    printf("  -n N       number of games (default 1)\n");
+    printf("  -p N       pieces per game, 0 = until game over (default 10000)\n");
+    printf("  -d N       search depth, 1 = current piece, 2 = with next piece (default 2)\n");
+    printf("  -j N       search threads (default number of cpus)\n");
+    printf("  -s SEED    random seed of the first game, game i uses SEED+i (default 1)\n");
+}
+
+int main(int argc, char** argv) {
+    int num_games = 1;
+    int max_pieces = 10000;
+    int depth = 2;
+    int num_threads = 0;
+    uint64_t seed = 1;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (arg[0] != '-' || !arg[1] || arg[2] || !value) {
+            usage(argv[0]);
+            return 1;
+        }
+        i++;
+
+        switch (arg[1]) {
+            case 'n': num_games = atoi(value); break;
+            case 'p': max_pieces = atoi(value); break;
+            case 'd': depth = atoi(value); break;
+            case 'j': num_threads = atoi(value); break;
+            case 's': seed = strtoull(value, NULL, 0); break;
+            default: usage(argv[0]); return 1;
+        }
+    }
+
+    TETRIS_BOT* bot = tetris_bot_create(num_threads);
+    if (!bot) {
+        printf("can't create bot\n");
+        return 1;
+    }
+    tetris_bot_set_depth(bot, depth);
+
+    FLIPPER_CTX* ctx = flipper_ctx_create(FL_INIT_HEADLESS | FL_INIT_VIRTUAL_CLOCK);
+    if (!ctx) {
+        tetris_bot_destroy(bot);
+        return 1;
+    }
+    flipper_ctx_make_current(ctx);
+
+    uint64_t start = SDL_GetPerformanceCounter();
+    long long total_pieces = 0;
+
+    for (int i = 0; i < num_games; i++) {
+        flipper_random_seed(seed + i);
+
+        GAME g;
+        game_init(&g);
+        game_rand_piece(&g);
+
+        int n = 0;
+        while (max_pieces == 0 || n < max_pieces) {
+            TETRIS_MOVE move;
+            if (!valid_block(&g, &g.block) || !tetris_bot_best_move(bot, &g, &move))
+                break;
+            g.block = move.block;
+            freeze_block_on_field(&g);
+            game_rand_piece(&g);
+            n++;
+        }
+        total_pieces += n;
+        printf("game %d: seed %llu, %d pieces, %d lines%s\n", i, (unsigned long long)(seed + i),
+               n, g.score, max_pieces != 0 && n == max_pieces ? "" : ", game over");
+    }
+
+    uint64_t end = SDL_GetPerformanceCounter();
+    double seconds = (double)(end - start) / (double)SDL_GetPerformanceFrequency();
+    uint64_t placements = tetris_bot_get_placements(bot);
+
+    fprintf(stderr, "%lld pieces in %.3f s, %.0f pieces/s, %.0f placements/s\n", total_pieces,
+            seconds, total_pieces / seconds, placements / seconds);
+
+    flipper_ctx_make_current(NULL);
+    flipper_ctx_destroy(ctx);
+    tetris_bot_destroy(bot);
+    return 0;
+}
@@ -3,10 +3,12 @@
 #include <SDL.h>
 #include <SDL_image.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <time.h>
 
 #include "flipper.h"
+#include "flipper_ctx.h"
 
 #define UI_BG_WIDTH 823
 #define UI_BG_HEIGHT 365
@@ -14,10 +16,17 @@
 #define UI_SCR_LEFT 238
 #define UI_SCR_TOP 71
 
-//#define TICK_INTERVAL 20   // 50 FPS -> 1000/50 = 20 ms
-#define TICK_INTERVAL 40  // 25 FPS -> 1000/25 = 40 ms
+#define DEFAULT_FPS 25
+#define MAX_FPS 1000
+
+// frame pacing sleeps until this many ms before the deadline, then spins
+#define PACE_SPIN_MS 2
+
+// FLIPPER_SIM_BENCH runs are seeded the same unless FLIPPER_SIM_SEED or a replay says otherwise
+#define BENCH_SEED 1
 
 #define HIGHLIGHT_TIME 100
+#define HIGHLIGHT_SIZE 64
 #define NUM_HIGHLIGHT_BUTTONS 6
 
 #define UI_NORMAL
@@ -89,27 +98,106 @@ int map_rotated_button[6] = {
 
 ////////////////////////////////////////////////////////////////
 
-SDL_Window* window;
-SDL_Renderer* renderer;
-SDL_Texture* screen;
+#define RANDOM_MULTIPLIER 6364136223846793005ULL
+#define RANDOM_INCREMENT 1442695040888963407ULL
 
-SDL_Texture* ui_highlight;
-SDL_Texture* ui_background;
-bool ui_rotate = false;
+#if defined(_MSC_VER)
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL _Thread_local
+#endif
 
-uint32_t* lcd_buffer;
+// the flipper_* functions without context operate on the current instance of the calling
+// thread, which is the default instance unless flipper_ctx_make_current was called
+static FLIPPER_CTX default_ctx;
+static THREAD_LOCAL FLIPPER_CTX* current_ctx = &default_ctx;
 
-uint8_t gpio_state[FL_GPIO_COUNT] = { 0 };
-int32_t key_time[FL_GPIO_COUNT] = { 0 };
+// windowed contexts using SDL_image, IMG_Quit isn't reference counted like SDL_QuitSubSystem
+static SDL_atomic_t img_users;
 
 ////////////////////////////////////////////////////////////////
 
-bool flipper_init(int flags) {
-    srand((unsigned int)time(0));
+static int env_int(const char* name, int def) {
+    const char* value = getenv(name);
+    if (!value || !*value)
+        return def;
+    return atoi(value);
+}
+
+static bool init_window(FLIPPER_CTX* ctx, int flags);
+static void golden_frame(FLIPPER_CTX* ctx);
+
+static bool ctx_init(FLIPPER_CTX* ctx, int flags) {
+    memset(ctx, 0, sizeof(*ctx));
+
+    flipper_ctx_random_seed(ctx, (uint64_t)time(0) ^ SDL_GetPerformanceCounter() ^ (uintptr_t)ctx);
+
+    ctx->ui_rotate = (flags & FL_INIT_SIMULATOR_ROTATE) != 0;
+    ctx->headless = (flags & FL_INIT_HEADLESS) != 0;
+    ctx->virtual_clock = (flags & FL_INIT_VIRTUAL_CLOCK) != 0;
+    ctx->events_enabled = (flags & FL_INIT_EVENTS) != 0;
+    ctx->lcd_fg = LCD_COLOR_FG;
+    ctx->lcd_bg = LCD_COLOR_BG;
+    ctx->fps = DEFAULT_FPS;
+    ctx->pace_policy = FL_PACE_DROP;
+    ctx->time_base = SDL_GetPerformanceCounter();
+    flipper_event_queue_init(&ctx->events);
+    flipper_text_init();
+    flipper_stats_init(&ctx->stats, (flags & FL_INIT_STATS) != 0);
+
+    // headless: only the lcd memory, no window, renderer or ui images
+    if (!ctx->headless && !init_window(ctx, flags))
+        return false;
+
+    return true;
+}
+
+// loads a png as ARGB pixels composed over black and scaled to width x height (nearest),
+// rotated by 90 degrees clockwise the same way SDL_RenderCopyEx did it before the skin cache
+static uint32_t* load_image(const char* path, int width, int height, bool rotate) {
+    SDL_Surface* loaded = IMG_Load(path);
+    if (!loaded) {
+        printf("flipper_init: IMG_Load %s\n", path);
+        return NULL;
+    }
+    SDL_Surface* surface = SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_ARGB8888, 0);
+    SDL_FreeSurface(loaded);
+    if (!surface) {
+        printf("flipper_init: SDL_ConvertSurfaceFormat %s\n", path);
+        return NULL;
+    }
+
+    uint32_t* pixels = (uint32_t*)SDL_malloc((size_t)width * height * sizeof(uint32_t));
+    if (!pixels) {
+        printf("flipper_init: malloc %s\n", path);
+        SDL_FreeSurface(surface);
+        return NULL;
+    }
 
-    memset(gpio_state, 0, sizeof(gpio_state));
-    memset(key_time, 0, sizeof(key_time));
+    int out_width = rotate ? height : width;
+    for (int y = 0; y < height; y++) {
+        const uint8_t* src = (const uint8_t*)surface->pixels;
+        const uint32_t* row = (const uint32_t*)(src + y * surface->h / height * surface->pitch);
+        for (int x = 0; x < width; x++) {
+            uint32_t c = row[x * surface->w / width];
+            uint32_t a = c >> 24;
+            uint32_t r = ((c >> 16) & 0xff) * a / 255;
+            uint32_t g = ((c >> 8) & 0xff) * a / 255;
+            uint32_t b = (c & 0xff) * a / 255;
+            c = 0xff000000 | (r << 16) | (g << 8) | b;
+
+            if (rotate)
+                pixels[x * out_width + height - 1 - y] = c;
+            else
+                pixels[y * out_width + x] = c;
+        }
+    }
 
+    SDL_FreeSurface(surface);
+    return pixels;
+}
+
+static bool init_window(FLIPPER_CTX* ctx, int flags) {
     int init = SDL_Init(SDL_INIT_EVERYTHING);
     if (init != 0) {
         printf("flipper_init: SDL_Init %s\n", IMG_GetError());
@@ -121,256 +209,1066 @@ bool flipper_init(int flags) {
         printf("flipper_init: IMG_Init %s\n", IMG_GetError());
         return false;
     }
+    ctx->img_init = true;
+    SDL_AtomicIncRef(&img_users);
 
     int width = UI_BG_WIDTH;
     int height = UI_BG_HEIGHT;
 
-    if (flags & FL_INIT_SIMULATOR_ROTATE) {
-        ui_rotate = true;
+    if (ctx->ui_rotate) {
         width = UI_BG_HEIGHT;
         height = UI_BG_WIDTH;
     }
 
-    window = SDL_CreateWindow("Flipper Zero Simulator", SDL_WINDOWPOS_UNDEFINED,
-                              SDL_WINDOWPOS_UNDEFINED, width, height, 0);
+    ctx->window = SDL_CreateWindow("Flipper Zero Simulator", SDL_WINDOWPOS_UNDEFINED,
+                                   SDL_WINDOWPOS_UNDEFINED, width, height, 0);
 
-    renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_SOFTWARE);
-    if (!renderer) {
+    // the software renderer also works without a gpu, e.g. with SDL_VIDEODRIVER=offscreen
+    Uint32 vsync = (flags & FL_INIT_VSYNC) ? SDL_RENDERER_PRESENTVSYNC : 0;
+    if (flags & FL_INIT_ACCELERATED) {
+        ctx->renderer = SDL_CreateRenderer(ctx->window, -1, SDL_RENDERER_ACCELERATED | vsync);
+        if (!ctx->renderer)
+            printf("flipper_init: no accelerated renderer, using software\n");
+    }
+    if (!ctx->renderer)
+        ctx->renderer = SDL_CreateRenderer(ctx->window, -1, SDL_RENDERER_SOFTWARE | vsync);
+    if (!ctx->renderer) {
         printf("flipper_init: SDL_CreateRenderer\n");
         return false;
     }
 
-    SDL_SetRenderDrawColor(renderer, 0, 0, 0, SDL_ALPHA_OPAQUE);
-    SDL_RenderClear(renderer);
-    SDL_RenderPresent(renderer);
+    SDL_SetRenderDrawColor(ctx->renderer, 0, 0, 0, SDL_ALPHA_OPAQUE);
+    SDL_RenderClear(ctx->renderer);
+    SDL_RenderPresent(ctx->renderer);
 
-    screen = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGB888, SDL_TEXTUREACCESS_STATIC,
-                               FL_LCD_WIDTH, FL_LCD_HEIGHT);
-    if (!screen) {
-        printf("flipper_init: SDL_CreateTexture screen\n");
+    ctx->skin_width = width;
+    ctx->skin_height = height;
+    ctx->skin_base = load_image(UI_BG_PNG, UI_BG_WIDTH, UI_BG_HEIGHT, ctx->ui_rotate);
+    if (!ctx->skin_base)
         return false;
-    }
 
-    lcd_buffer = (uint32_t*)calloc(FL_LCD_WIDTH * FL_LCD_HEIGHT * sizeof(uint32_t), 1);
-    if (!lcd_buffer) {
-        printf("flipper_init: calloc pixels\n");
+    ctx->highlight_pixels = load_image(UI_HIGHTLIGHT_PNG, HIGHLIGHT_SIZE, HIGHLIGHT_SIZE, false);
+    if (!ctx->highlight_pixels)
         return false;
-    }
 
-    ui_background = IMG_LoadTexture(renderer, UI_BG_PNG);
-    if (!ui_background) {
-        printf("flipper_init: IMG_LoadTexture %s\n", UI_BG_PNG);
+    ctx->ui_skin = SDL_CreateTexture(ctx->renderer, SDL_PIXELFORMAT_ARGB8888,
+                                     SDL_TEXTUREACCESS_STREAMING, width, height);
+    if (!ctx->ui_skin) {
+        printf("flipper_init: SDL_CreateTexture skin\n");
         return false;
     }
-
-    ui_highlight = IMG_LoadTexture(renderer, UI_HIGHTLIGHT_PNG);
-    if (!ui_highlight) {
-        printf("flipper_init: IMG_LoadTexture %s\n", UI_HIGHTLIGHT_PNG);
-        return false;
+    SDL_SetTextureBlendMode(ctx->ui_skin, SDL_BLENDMODE_NONE);
+
+    // the lcd is shown at 2x, transposed in the rotated window so the long side runs down
+    if (ctx->ui_rotate) {
+        ctx->skin_lcd.x = UI_BG_HEIGHT - UI_SCR_TOP - FL_LCD_HEIGHT * 2;
+        ctx->skin_lcd.y = UI_SCR_LEFT;
+        ctx->skin_lcd.w = FL_LCD_HEIGHT * 2;
+        ctx->skin_lcd.h = FL_LCD_WIDTH * 2;
+        ctx->lcd_expand = flipper_expand_best(FLIPPER_EXPAND_2X_ROTATED);
+    } else {
+        ctx->skin_lcd.x = UI_SCR_LEFT;
+        ctx->skin_lcd.y = UI_SCR_TOP;
+        ctx->skin_lcd.w = FL_LCD_WIDTH * 2;
+        ctx->skin_lcd.h = FL_LCD_HEIGHT * 2;
+        ctx->lcd_expand = flipper_expand_best(FLIPPER_EXPAND_2X);
     }
 
-    SDL_SetTextureBlendMode(ui_highlight, SDL_BLENDMODE_ADD);
+    // the texture starts out with undefined contents
+    ctx->redraw = true;
 
-    flipper_pixel_reset();
-    flipper_lcd_update();
+    flipper_ctx_pixel_reset(ctx);
+    flipper_ctx_lcd_update(ctx);
+    ctx->frame_count = 0;
 
     return true;
 }
 
-void flipper_close() {
-    SDL_DestroyTexture(screen);
-    free(lcd_buffer);
-    SDL_DestroyTexture(ui_background);
-    SDL_DestroyTexture(ui_highlight);
+static void ctx_close(FLIPPER_CTX* ctx) {
+    flipper_capture_destroy(ctx->capture);
+    ctx->capture = NULL;
+    flipper_shm_destroy(ctx->shm);
+    ctx->shm = NULL;
+    flipper_input_log_close(&ctx->input_record);
+    flipper_input_log_close(&ctx->input_replay);
+    flipper_golden_close(&ctx->hash_record);
+    flipper_golden_close(&ctx->hash_check);
+    SDL_free(ctx->hash_check_path);
+    ctx->hash_check_path = NULL;
+
+    if (ctx->headless)
+        return;
+
+    SDL_DestroyTexture(ctx->ui_skin);
+    SDL_free(ctx->skin_base);
+    SDL_free(ctx->highlight_pixels);
 
-    SDL_DestroyWindow(window);
-    SDL_Quit();
+    SDL_DestroyRenderer(ctx->renderer);
+    SDL_DestroyWindow(ctx->window);
+    if (ctx->img_init && SDL_AtomicDecRef(&img_users))
+        IMG_Quit();
+    SDL_QuitSubSystem(SDL_INIT_EVERYTHING);
 }
 
-void flipper_pixel_set(int x, int y) {
+FLIPPER_CTX* flipper_ctx_create(int flags) {
+    FLIPPER_CTX* ctx = (FLIPPER_CTX*)SDL_malloc(sizeof(FLIPPER_CTX));
+    if (!ctx) {
+        printf("flipper_ctx_create: malloc\n");
+        return NULL;
+    }
+
+    if (!ctx_init(ctx, flags)) {
+        ctx_close(ctx);
+        SDL_free(ctx);
+        return NULL;
+    }
+    return ctx;
+}
+
+void flipper_ctx_destroy(FLIPPER_CTX* ctx) {
+    if (!ctx)
+        return;
+    ctx_close(ctx);
+    SDL_free(ctx);
+}
+
+void flipper_ctx_set_frame_limit(FLIPPER_CTX* ctx, int frames) {
+    ctx->frame_limit = frames > 0 ? frames : 0;
+}
+
+void flipper_ctx_make_current(FLIPPER_CTX* ctx) {
+    current_ctx = ctx ? ctx : &default_ctx;
+}
+
+FLIPPER_CTX* flipper_ctx_get_current() {
+    return current_ctx;
+}
+
+int flipper_ctx_get_frame_count(FLIPPER_CTX* ctx) {
+    return ctx->frame_count;
+}
+
+int flipper_ctx_get_exit_reason(FLIPPER_CTX* ctx) {
+    return ctx->exit_reason;
+}
+
+void flipper_ctx_set_score(FLIPPER_CTX* ctx, int score) {
+    ctx->score = score;
+}
+
+int flipper_ctx_get_score(FLIPPER_CTX* ctx) {
+    return ctx->score;
+}
+
+bool flipper_ctx_stats_get(FLIPPER_CTX* ctx, int phase, FLIPPER_PHASE_STATS* stats) {
+    if (!ctx->stats.enabled || phase < 0 || phase >= FL_PHASE_COUNT)
+        return false;
+    flipper_stats_compute(&ctx->stats, phase, stats);
+    return true;
+}
+
+void flipper_ctx_stats_print(FLIPPER_CTX* ctx) {
+    if (ctx->stats.enabled)
+        flipper_stats_dump(&ctx->stats);
+}
+
+void flipper_ctx_pixel_set(FLIPPER_CTX* ctx, int x, int y) {
     if (x < 0 || x >= FL_LCD_WIDTH)
         return;
     if (y < 0 || y >= FL_LCD_HEIGHT)
         return;
 
-    lcd_buffer[y * FL_LCD_WIDTH + x] = LCD_COLOR_FG;
+    ctx->lcd_buffer[(y >> 3) * FL_LCD_WIDTH + x] |= 1 << (y & 7);
 }
 
-void flipper_pixel_clear(int x, int y) {
+void flipper_ctx_pixel_clear(FLIPPER_CTX* ctx, int x, int y) {
     if (x < 0 || x >= FL_LCD_WIDTH)
         return;
     if (y < 0 || y >= FL_LCD_HEIGHT)
         return;
 
-    lcd_buffer[y * FL_LCD_WIDTH + x] = LCD_COLOR_BG;
+    ctx->lcd_buffer[(y >> 3) * FL_LCD_WIDTH + x] &= ~(1 << (y & 7));
 }
 
-bool flipper_pixel_get(int x, int y) {
+bool flipper_ctx_pixel_get(FLIPPER_CTX* ctx, int x, int y) {
     if (x < 0 || x >= FL_LCD_WIDTH)
         return 0;
     if (y < 0 || y >= FL_LCD_HEIGHT)
         return 0;
 
-    return lcd_buffer[y * FL_LCD_WIDTH + x] == LCD_COLOR_FG;
+    return (ctx->lcd_buffer[(y >> 3) * FL_LCD_WIDTH + x] >> (y & 7)) & 1;
 }
 
 // fill screen with background color
-void flipper_pixel_reset() {
-    for (int i = 0; i < FL_LCD_WIDTH * FL_LCD_HEIGHT; i++) {
-        lcd_buffer[i] = LCD_COLOR_BG;
+void flipper_ctx_pixel_reset(FLIPPER_CTX* ctx) {
+    memset(ctx->lcd_buffer, 0, FL_LCD_BUFFER_SIZE);
+}
+
+// locked texture memory is write only (it may be a fresh upload buffer), so every pixel
+// of a locked rect has to be written
+static uint32_t* skin_lock(FLIPPER_CTX* ctx, const SDL_Rect* r, int* pitch) {
+    void* pixels;
+    int bytes;
+    if (SDL_LockTexture(ctx->ui_skin, r, &pixels, &bytes) != 0) {
+        printf("flipper_lcd_update: SDL_LockTexture %s\n", SDL_GetError());
+        return NULL;
     }
+    *pitch = bytes / (int)sizeof(uint32_t);
+    return (uint32_t*)pixels;
 }
 
-void flipper_lcd_update() {
-    // draw the background image to the window
-    if (ui_rotate) {
-        SDL_Rect destRect;
-        destRect.x = 0;
-        destRect.y = 0;
-        destRect.w = UI_BG_WIDTH;
-        destRect.h = UI_BG_HEIGHT;
-
-        SDL_Point rotatePoint;
-        rotatePoint.x = UI_BG_HEIGHT / 2;
-        rotatePoint.y = UI_BG_HEIGHT / 2;  // what?
-
-        SDL_RenderCopyEx(renderer, ui_background, NULL, &destRect, 90, &rotatePoint, 0);
-    } else
-        SDL_RenderCopy(renderer, ui_background, NULL, NULL);
-
-    // add button highlights
-    int32_t now = SDL_GetTicks();
-
-    HIGHLIGHT_BUTTON* hb = highlight_buttons;
-    for (int i = 0; i < NUM_HIGHLIGHT_BUTTONS; i++) {
-        if (flipper_gpio_get(hb[i].gpio) && now - key_time[hb[i].gpio] < HIGHLIGHT_TIME) {
-            SDL_Rect destRect;
-            destRect.w = 64;
-            destRect.h = 64;
-            if (ui_rotate) {
-                destRect.x = UI_BG_HEIGHT - 64 - hb[i].y;
-                destRect.y = hb[i].x;
-            } else {
-                destRect.x = hb[i].x;
-                destRect.y = hb[i].y;
+static void skin_background(FLIPPER_CTX* ctx) {
+    SDL_Rect r = { 0, 0, ctx->skin_width, ctx->skin_height };
+    int pitch;
+    uint32_t* dst = skin_lock(ctx, &r, &pitch);
+    if (!dst)
+        return;
+
+    for (int y = 0; y < r.h; y++) {
+        memcpy(&dst[y * pitch], &ctx->skin_base[y * ctx->skin_width], r.w * sizeof(uint32_t));
+    }
+    SDL_UnlockTexture(ctx->ui_skin);
+}
+
+// writes a highlight area of the skin from the background with the highlight on top if it
+// is lit (the same saturating add as SDL_BLENDMODE_ADD, colors are premultiplied), dst points
+// to the top left pixel of r
+static void compose_highlight(const FLIPPER_CTX* ctx, uint32_t* dst, int pitch, const SDL_Rect* r,
+                              bool lit) {
+    for (int y = 0; y < r->h; y++) {
+        const uint32_t* base = &ctx->skin_base[(r->y + y) * ctx->skin_width + r->x];
+        if (!lit) {
+            memcpy(dst, base, r->w * sizeof(uint32_t));
+            dst += pitch;
+            continue;
+        }
+
+        const uint32_t* src = &ctx->highlight_pixels[y * HIGHLIGHT_SIZE];
+        for (int x = 0; x < r->w; x++) {
+            uint32_t c = 0xff000000;
+            for (int shift = 0; shift < 24; shift += 8) {
+                uint32_t sum = ((base[x] >> shift) & 0xff) + ((src[x] >> shift) & 0xff);
+                c |= (sum > 0xff ? 0xff : sum) << shift;
             }
+            dst[x] = c;
+        }
+        dst += pitch;
+    }
+}
+
+static void highlight_rect(const FLIPPER_CTX* ctx, int i, SDL_Rect* r) {
+    HIGHLIGHT_BUTTON* hb = &highlight_buttons[i];
+    r->w = HIGHLIGHT_SIZE;
+    r->h = HIGHLIGHT_SIZE;
+    if (ctx->ui_rotate) {
+        r->x = UI_BG_HEIGHT - HIGHLIGHT_SIZE - hb->y;
+        r->y = hb->x;
+    } else {
+        r->x = hb->x;
+        r->y = hb->y;
+    }
+}
+
+static void skin_highlight(FLIPPER_CTX* ctx, const SDL_Rect* r, bool lit) {
+    int pitch;
+    uint32_t* dst = skin_lock(ctx, r, &pitch);
+    if (!dst)
+        return;
+    compose_highlight(ctx, dst, pitch, r, lit);
+    SDL_UnlockTexture(ctx->ui_skin);
+}
+
+uint32_t flipper_ctx_lit_highlights(FLIPPER_CTX* ctx) {
+    int32_t now = flipper_ctx_get_tics(ctx);
+    uint32_t highlights = 0;
+    for (int i = 0; i < NUM_HIGHLIGHT_BUTTONS; i++) {
+        int gpio = highlight_buttons[i].gpio;
+        if (flipper_ctx_gpio_get(ctx, gpio) && now - ctx->key_time[gpio] < HIGHLIGHT_TIME)
+            highlights |= 1 << i;
+    }
+    return highlights;
+}
 
-            // draw the image to the window
-            SDL_RenderCopy(renderer, ui_highlight, NULL, &destRect);
+void flipper_ctx_skin_compose(const FLIPPER_CTX* ctx, uint32_t* dst, const uint8_t* lcd,
+                              uint32_t highlights) {
+    memcpy(dst, ctx->skin_base, (size_t)ctx->skin_width * ctx->skin_height * sizeof(uint32_t));
+    for (int i = 0; i < NUM_HIGHLIGHT_BUTTONS; i++) {
+        if (highlights & (1 << i)) {
+            SDL_Rect r;
+            highlight_rect(ctx, i, &r);
+            compose_highlight(ctx, &dst[r.y * ctx->skin_width + r.x], ctx->skin_width, &r, true);
         }
     }
+    const SDL_Rect* r = &ctx->skin_lcd;
+    ctx->lcd_expand(&dst[r->y * ctx->skin_width + r->x], ctx->skin_width, lcd, FL_LCD_PAGES,
+                    ctx->lcd_fg, ctx->lcd_bg);
+}
+
+void flipper_ctx_lcd_update(FLIPPER_CTX* ctx) {
+    FLIPPER_STATS* stats = &ctx->stats;
+    uint64_t t = flipper_stats_now(stats);
+    flipper_stats_add(stats, FL_PHASE_APP, stats->app_start, t);
+    flipper_stats_add(stats, FL_PHASE_FRAME, stats->frame_start, t);
+    stats->frame_start = t;
 
-    // update texture from pixels
-    SDL_UpdateTexture(screen, NULL, lcd_buffer, FL_LCD_WIDTH * sizeof(uint32_t));
+    if (ctx->capture) {
+        flipper_capture_frame(ctx->capture, ctx->frame_count, ctx->fps, ctx->lcd_buffer,
+                              flipper_ctx_lit_highlights(ctx));
+    }
 
-    // copy texture to screen (2x scale)
-    if (ui_rotate) {
-        SDL_Rect destRect;
-        destRect.x = UI_BG_HEIGHT - FL_LCD_HEIGHT - UI_SCR_TOP;
-        destRect.y = UI_SCR_LEFT;
-        destRect.w = FL_LCD_WIDTH * 2;
-        destRect.h = FL_LCD_HEIGHT * 2;
+    if (ctx->hash_record.file || ctx->hash_check.file)
+        golden_frame(ctx);
 
-        SDL_Point p;
-        p.x = FL_LCD_HEIGHT / 2;
-        p.y = FL_LCD_HEIGHT / 2;
+    if (ctx->shm) {
+        flipper_shm_publish(ctx->shm, ctx->frame_count, flipper_ctx_get_time_us(ctx),
+                            ctx->lcd_buffer);
+    }
 
-        SDL_RenderCopyEx(renderer, screen, NULL, &destRect, 90, &p, SDL_FLIP_VERTICAL);
-    } else {
-        SDL_Rect destRect;
-        destRect.x = UI_SCR_LEFT;
-        destRect.y = UI_SCR_TOP;
-        destRect.w = FL_LCD_WIDTH * 2;
-        destRect.h = FL_LCD_HEIGHT * 2;
+    ctx->frame_count++;
+    if (ctx->headless) {
+        stats->app_start = t;
+        return;
+    }
+
+    // find the lcd pages changed since the last present
+    int dirty_first = FL_LCD_PAGES;
+    int dirty_last = -1;
+    for (int page = 0; page < FL_LCD_PAGES; page++) {
+        int offset = page * FL_LCD_WIDTH;
+        if (memcmp(&ctx->lcd_buffer[offset], &ctx->lcd_presented[offset], FL_LCD_WIDTH) != 0) {
+            if (dirty_first == FL_LCD_PAGES)
+                dirty_first = page;
+            dirty_last = page;
+        }
+    }
+
+    uint32_t highlights = flipper_ctx_lit_highlights(ctx);
+
+    // the window still shows exactly this frame
+    if (dirty_last < 0 && highlights == ctx->highlights_presented && !ctx->redraw) {
+        stats->app_start = t;
+        return;
+    }
+
+    uint32_t changed = highlights ^ ctx->highlights_presented;
+    if (ctx->redraw) {
+        skin_background(ctx);
+        changed = highlights;
+        dirty_first = 0;
+        dirty_last = FL_LCD_PAGES - 1;
+    }
+
+    // expand the changed lcd pages straight into the texture
+    if (dirty_last >= 0) {
+        int pages = dirty_last - dirty_first + 1;
+        SDL_Rect r = ctx->skin_lcd;
+        if (ctx->ui_rotate) {
+            r.x += dirty_first * 16;
+            r.w = pages * 16;
+        } else {
+            r.y += dirty_first * 16;
+            r.h = pages * 16;
+        }
+
+        int pitch;
+        uint32_t* dst = skin_lock(ctx, &r, &pitch);
+        if (dst) {
+            int offset = dirty_first * FL_LCD_WIDTH;
+            ctx->lcd_expand(dst, pitch, &ctx->lcd_buffer[offset], pages, ctx->lcd_fg,
+                            ctx->lcd_bg);
+            SDL_UnlockTexture(ctx->ui_skin);
+            memcpy(&ctx->lcd_presented[offset], &ctx->lcd_buffer[offset], pages * FL_LCD_WIDTH);
+        }
+    }
+    t = flipper_stats_add(stats, FL_PHASE_UPLOAD, t, flipper_stats_now(stats));
 
-        SDL_RenderCopy(renderer, screen, NULL, &destRect);
+    // recomposite the highlights that went on or off
+    for (int i = 0; i < NUM_HIGHLIGHT_BUTTONS; i++) {
+        if (changed & (1 << i)) {
+            SDL_Rect r;
+            highlight_rect(ctx, i, &r);
+            skin_highlight(ctx, &r, highlights & (1 << i));
+        }
     }
+    ctx->highlights_presented = highlights;
+    t = flipper_stats_add(stats, FL_PHASE_HIGHLIGHT, t, flipper_stats_now(stats));
 
-    SDL_RenderPresent(renderer);
+    // renderers don't keep the previous frame after present, copy the whole skin
+    SDL_RenderCopy(ctx->renderer, ctx->ui_skin, NULL, NULL);
+    ctx->redraw = false;
+    t = flipper_stats_add(stats, FL_PHASE_BACKGROUND, t, flipper_stats_now(stats));
+
+    SDL_RenderPresent(ctx->renderer);
+    stats->app_start = flipper_stats_add(stats, FL_PHASE_PRESENT, t, flipper_stats_now(stats));
 }
 
-void flipper_lcd_constant_fps() {
-    static uint32_t next_frame = 0;
-    if (next_frame == 0)
-        next_frame = SDL_GetTicks() + TICK_INTERVAL;
+// frame n is due at pace_start + n / fps, so rounding never accumulates
+static uint64_t pace_deadline(FLIPPER_CTX* ctx, uint64_t frequency) {
+    return ctx->pace_start + ctx->pace_frame * frequency / ctx->fps;
+}
+
+static void pace_frame(FLIPPER_CTX* ctx) {
+    uint64_t frequency = SDL_GetPerformanceFrequency();
+    uint64_t now = SDL_GetPerformanceCounter();
+
+    if (ctx->pace_frame == 0) {
+        ctx->pace_start = now;
+        ctx->pace_frame = 1;
+    }
+
+    uint64_t deadline = pace_deadline(ctx, frequency);
+    if (now >= deadline) {
+        ctx->late_frames++;
+
+        switch (ctx->pace_policy) {
+            case FL_PACE_CATCH_UP:
+                // keep the schedule, following frames run back to back until it is met
+                ctx->pace_frame++;
+                return;
+            case FL_PACE_RESET:
+                // start a new schedule from now
+                ctx->pace_start = now;
+                ctx->pace_frame = 1;
+                return;
+            default: {
+                // FL_PACE_DROP: give up the missed slots and wait for the next one, so the
+                // rate stays steady
+                uint64_t due = (now - ctx->pace_start) * ctx->fps / frequency + 1;
+                if (due <= ctx->pace_frame)
+                    due = ctx->pace_frame + 1;
+                ctx->dropped_frames += (uint32_t)(due - ctx->pace_frame - 1);
+                ctx->pace_frame = due;
+                deadline = pace_deadline(ctx, frequency);
+                break;
+            }
+        }
+    }
+
+    // coarse sleep, then spin for the last few ms for an accurate wakeup
+    uint64_t remaining_ms = (deadline - now) * 1000 / frequency;
+    if (remaining_ms > PACE_SPIN_MS)
+        SDL_Delay((uint32_t)(remaining_ms - PACE_SPIN_MS));
+    while (SDL_GetPerformanceCounter() < deadline) {
+    }
+    ctx->pace_frame++;
+}
+
+void flipper_ctx_lcd_constant_fps(FLIPPER_CTX* ctx) {
+    FLIPPER_STATS* stats = &ctx->stats;
+    uint64_t t = flipper_stats_now(stats);
+
+    if (ctx->virtual_clock)
+        ctx->virtual_frames++;
+    else if (!ctx->headless)
+        pace_frame(ctx);
+
+    stats->app_start = flipper_stats_add(stats, FL_PHASE_SLEEP, t, flipper_stats_now(stats));
+}
+
+void flipper_ctx_lcd_set_fps(FLIPPER_CTX* ctx, int fps) {
+    if (fps < 1)
+        fps = 1;
+    if (fps > MAX_FPS)
+        fps = MAX_FPS;
+
+    // continue virtual time and the schedule from here at the new rate
+    ctx->virtual_base = flipper_ctx_get_tics(ctx);
+    ctx->virtual_frames = 0;
+    ctx->pace_frame = 0;
+    ctx->fps = fps;
+}
+
+int flipper_ctx_lcd_get_fps(FLIPPER_CTX* ctx) {
+    return ctx->fps;
+}
 
-    int32_t remaining = next_frame - SDL_GetTicks();
-    if (remaining > 0)
-        SDL_Delay(remaining);
-    next_frame += TICK_INTERVAL;
+void flipper_ctx_lcd_set_pacing(FLIPPER_CTX* ctx, int policy) {
+    ctx->pace_policy = policy;
 }
 
-static int key_to_gpio(int key) {
-    if (ui_rotate && (key >= 0 && key < 6))
+int flipper_ctx_lcd_get_late_frames(FLIPPER_CTX* ctx) {
+    return ctx->late_frames;
+}
+
+int flipper_ctx_lcd_get_dropped_frames(FLIPPER_CTX* ctx) {
+    return ctx->dropped_frames;
+}
+
+static int key_to_gpio(FLIPPER_CTX* ctx, int key) {
+    if (ctx->ui_rotate && (key >= 0 && key < 6))
         return map_rotated_button[key];
     return key;
 }
 
-void flipper_gpio_update() {
+// time_us is when the change happened, which can be before it is seen in flipper_gpio_update
+static void gpio_change_at(FLIPPER_CTX* ctx, int pin, bool is_down, uint64_t time_us) {
+    // key repeats only refresh key_time, they are not queued as changes
+    if (ctx->events_enabled && ctx->gpio_state[pin] != is_down) {
+        FLIPPER_EVENT ev;
+        ev.time_us = time_us;
+        ev.pin = pin;
+        ev.down = is_down;
+        if (!flipper_event_queue_push(&ctx->events, &ev))
+            ctx->events_dropped++;
+    }
+
+    ctx->gpio_state[pin] = is_down;
+    ctx->key_time[pin] = flipper_ctx_get_tics(ctx);
+
+    if (ctx->input_record.file) {
+        FLIPPER_INPUT_EVENT ev;
+        ev.frame = ctx->input_frame;
+        ev.pin = pin;
+        ev.state = is_down;
+        flipper_input_log_write(&ctx->input_record, &ev);
+    }
+}
+
+static void gpio_change(FLIPPER_CTX* ctx, int pin, bool is_down) {
+    gpio_change_at(ctx, pin, is_down, flipper_ctx_get_time_us(ctx));
+}
+
+static void gpio_exit(FLIPPER_CTX* ctx, int reason) {
+    if (!ctx->gpio_state[FL_GPIO_SIMULATOR_EXIT]) {
+        gpio_change(ctx, FL_GPIO_SIMULATOR_EXIT, true);
+        ctx->exit_reason = reason;
+    }
+}
+
+static void gpio_replay(FLIPPER_CTX* ctx) {
+    while (ctx->replay_pending && ctx->replay_next.frame <= ctx->input_frame) {
+        gpio_change(ctx, ctx->replay_next.pin, ctx->replay_next.state);
+        ctx->replay_pending = flipper_input_log_read(&ctx->input_replay, &ctx->replay_next);
+    }
+    if (ctx->gpio_state[FL_GPIO_SIMULATOR_EXIT] && !ctx->exit_reason)
+        ctx->exit_reason = FL_EXIT_USER;
+
+    // the recorded session is over
+    if (!ctx->replay_pending)
+        gpio_exit(ctx, FL_EXIT_REPLAY_END);
+}
+
+// the fixed input of benchmark runs without a replay
+static void gpio_script(FLIPPER_CTX* ctx) {
+    int release, press;
+    flipper_bench_script(&ctx->bench, ctx->input_frame, &release, &press);
+    if (release != -1)
+        gpio_change(ctx, release, false);
+    if (press != -1)
+        gpio_change(ctx, press, true);
+}
+
+// button changes from a driver process, see flipper_shm.h
+static void gpio_poll_shm(FLIPPER_CTX* ctx) {
+    FLIPPER_SHM_INPUT_EVENT event;
+    while (flipper_shm_poll(ctx->shm, &event)) {
+        // like the keyboard, ignored while replaying
+        if (ctx->input_replay.file)
+            continue;
+        if (event.pin == FL_GPIO_SIMULATOR_EXIT)
+            gpio_exit(ctx, FL_EXIT_USER);
+        else if (event.pin < FL_GPIO_COUNT)
+            gpio_change(ctx, event.pin, event.down != 0);
+    }
+}
+
+static void gpio_poll_sdl(FLIPPER_CTX* ctx) {
     SDL_Event event;
+    uint64_t now_us = flipper_ctx_get_time_us(ctx);
+    uint32_t now_tics = SDL_GetTicks();
 
+    // every pending event is handled, a press and release within one frame both count
     while (SDL_PollEvent(&event)) {
-        if (event.type == SDL_KEYDOWN || event.type == SDL_KEYUP) {
+        // keyboard is ignored while replaying
+        if ((event.type == SDL_KEYDOWN || event.type == SDL_KEYUP) && !ctx->input_replay.file) {
             bool is_down = event.type == SDL_KEYDOWN;
+            int pin = -1;
 
             switch (event.key.keysym.sym) {
-                case SDLK_UP:
-                    gpio_state[key_to_gpio(FL_GPIO_BUTTON_UP)] = is_down;
-                    key_time[key_to_gpio(FL_GPIO_BUTTON_UP)] = SDL_GetTicks();
-                    break;
-                case SDLK_DOWN:
-                    gpio_state[key_to_gpio(FL_GPIO_BUTTON_DOWN)] = is_down;
-                    key_time[key_to_gpio(FL_GPIO_BUTTON_DOWN)] = SDL_GetTicks();
-                    break;
-                case SDLK_LEFT:
-                    gpio_state[key_to_gpio(FL_GPIO_BUTTON_LEFT)] = is_down;
-                    key_time[key_to_gpio(FL_GPIO_BUTTON_LEFT)] = SDL_GetTicks();
-                    break;
-                case SDLK_RIGHT:
-                    gpio_state[key_to_gpio(FL_GPIO_BUTTON_RIGHT)] = is_down;
-                    key_time[key_to_gpio(FL_GPIO_BUTTON_RIGHT)] = SDL_GetTicks();
-                    break;
-                case SDLK_BACKSPACE:
-                    gpio_state[FL_GPIO_BUTTON_BACK] = is_down;
-                    key_time[FL_GPIO_BUTTON_BACK] = SDL_GetTicks();
-                    break;
-                case SDLK_RETURN:
-                    gpio_state[FL_GPIO_BUTTON_ENTER] = is_down;
-                    key_time[FL_GPIO_BUTTON_ENTER] = SDL_GetTicks();
-                    break;
+                case SDLK_UP: pin = key_to_gpio(ctx, FL_GPIO_BUTTON_UP); break;
+                case SDLK_DOWN: pin = key_to_gpio(ctx, FL_GPIO_BUTTON_DOWN); break;
+                case SDLK_LEFT: pin = key_to_gpio(ctx, FL_GPIO_BUTTON_LEFT); break;
+                case SDLK_RIGHT: pin = key_to_gpio(ctx, FL_GPIO_BUTTON_RIGHT); break;
+                case SDLK_BACKSPACE: pin = FL_GPIO_BUTTON_BACK; break;
+                case SDLK_RETURN: pin = FL_GPIO_BUTTON_ENTER; break;
 
                 case SDLK_ESCAPE:
-                case SDLK_q: gpio_state[FL_GPIO_SIMULATOR_EXIT] = 1; break;
+                case SDLK_q: gpio_exit(ctx, FL_EXIT_USER); break;
+            }
+            if (pin != -1) {
+                // key events carry the ms tics they arrived at, date the change back to that
+                uint64_t age_us = (uint64_t)(now_tics - event.key.timestamp) * 1000;
+                uint64_t time_us = ctx->virtual_clock || age_us > now_us ? now_us : now_us - age_us;
+                gpio_change_at(ctx, pin, is_down, time_us);
             }
-            break;
+            continue;
         }
         if (event.type == SDL_WINDOWEVENT) {
             if (event.window.event == SDL_WINDOWEVENT_CLOSE) {
-                gpio_state[FL_GPIO_SIMULATOR_EXIT] = 1;
+                gpio_exit(ctx, FL_EXIT_USER);
+            }
+            // window contents were lost, present again even if the lcd did not change
+            if (event.window.event == SDL_WINDOWEVENT_EXPOSED ||
+                event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED) {
+                ctx->redraw = true;
             }
         }
+        if (event.type == SDL_RENDER_TARGETS_RESET)
+            ctx->redraw = true;
     }
 }
 
-bool flipper_gpio_get(int pin) {
-    if (pin < 0 || pin >= sizeof(gpio_state))
+void flipper_ctx_gpio_update(FLIPPER_CTX* ctx) {
+    if (ctx->frame_limit && ctx->frame_count >= ctx->frame_limit)
+        gpio_exit(ctx, FL_EXIT_FRAME_LIMIT);
+
+    if (ctx->input_replay.file)
+        gpio_replay(ctx);
+    else if (ctx->bench.enabled)
+        gpio_script(ctx);
+    if (ctx->shm)
+        gpio_poll_shm(ctx);
+    if (!ctx->headless)
+        gpio_poll_sdl(ctx);
+
+    ctx->input_frame++;
+}
+
+bool flipper_ctx_gpio_get(FLIPPER_CTX* ctx, int pin) {
+    if (pin < 0 || pin >= FL_GPIO_COUNT)
         return false;
-    return gpio_state[pin] == 1;
+    return ctx->gpio_state[pin] == 1;
 }
 
-int flipper_key_get_time(int pin) {
-    if (pin < 0 || pin >= sizeof(gpio_state))
+void flipper_ctx_gpio_set(FLIPPER_CTX* ctx, int pin) {
+    if (pin < 0 || pin >= FL_GPIO_COUNT)
+        return;
+    gpio_change(ctx, pin, true);
+}
+
+uint64_t flipper_ctx_get_time_us(FLIPPER_CTX* ctx) {
+    if (ctx->virtual_clock) {
+        uint64_t frames_us = (uint64_t)ctx->virtual_frames * 1000000 / ctx->fps;
+        return (uint64_t)ctx->virtual_base * 1000 + frames_us;
+    }
+
+    uint64_t frequency = SDL_GetPerformanceFrequency();
+    uint64_t elapsed = SDL_GetPerformanceCounter() - ctx->time_base;
+    return elapsed / frequency * 1000000 + elapsed % frequency * 1000000 / frequency;
+}
+
+bool flipper_ctx_event_get(FLIPPER_CTX* ctx, FLIPPER_EVENT* event) {
+    return flipper_event_queue_pop(&ctx->events, event);
+}
+
+int flipper_ctx_key_get_time(FLIPPER_CTX* ctx, int pin) {
+    if (pin < 0 || pin >= FL_GPIO_COUNT)
         return 0;
-    if (gpio_state[pin] == 0)
+    if (ctx->gpio_state[pin] == 0)
         return 0;
 
-    return key_time[pin];
+    return ctx->key_time[pin];
 }
 
-int flipper_random(int range) {
-    return rand() % range;
+bool flipper_ctx_input_record(FLIPPER_CTX* ctx, const char* path) {
+    flipper_input_log_close(&ctx->input_record);
+    return flipper_input_log_create(&ctx->input_record, path, ctx->rng.seed);
 }
 
-int flipper_get_tics() {
+bool flipper_ctx_input_replay(FLIPPER_CTX* ctx, const char* path) {
+    flipper_input_log_close(&ctx->input_replay);
+    uint64_t seed;
+    if (!flipper_input_log_open(&ctx->input_replay, path, &seed))
+        return false;
+
+    // same random sequence as in the recorded session
+    flipper_ctx_random_seed(ctx, seed);
+    ctx->replay_pending = flipper_input_log_read(&ctx->input_replay, &ctx->replay_next);
+    return true;
+}
+
+bool flipper_ctx_hash_record(FLIPPER_CTX* ctx, const char* path) {
+    flipper_golden_close(&ctx->hash_record);
+    return flipper_golden_create(&ctx->hash_record, path, ctx->rng.seed);
+}
+
+bool flipper_ctx_hash_check(FLIPPER_CTX* ctx, const char* path) {
+    flipper_golden_close(&ctx->hash_check);
+    SDL_free(ctx->hash_check_path);
+    ctx->hash_check_path = NULL;
+    ctx->golden_failed = false;
+
+    uint64_t seed;
+    if (!flipper_golden_open(&ctx->hash_check, path, &seed))
+        return false;
+    ctx->hash_check_path = SDL_strdup(path);
+
+    // same random sequence as in the recorded run
+    flipper_ctx_random_seed(ctx, seed);
+    return true;
+}
+
+// the lcd as binary pbm, white is a clear pixel
+static void golden_dump(FLIPPER_CTX* ctx, uint32_t frame) {
+    char path[1024];
+    snprintf(path, sizeof(path), "%s.%u.pbm", ctx->hash_check_path, frame);
+    FILE* f = fopen(path, "wb");
+    if (!f) {
+        printf("flipper_hash_check: can't create %s\n", path);
+        return;
+    }
+
+    fprintf(f, "P4\n%d %d\n", FL_LCD_WIDTH, FL_LCD_HEIGHT);
+    for (int y = 0; y < FL_LCD_HEIGHT; y++) {
+        const uint8_t* page = &ctx->lcd_buffer[(y >> 3) * FL_LCD_WIDTH];
+        uint8_t row[FL_LCD_WIDTH / 8] = { 0 };
+        for (int x = 0; x < FL_LCD_WIDTH; x++) {
+            if ((page[x] >> (y & 7)) & 1)
+                row[x >> 3] |= 0x80 >> (x & 7);
+        }
+        fwrite(row, sizeof(row), 1, f);
+    }
+    fclose(f);
+    printf("flipper_hash_check: frame %u written to %s\n", frame, path);
+}
+
+static void golden_fail(FLIPPER_CTX* ctx) {
+    ctx->golden_failed = true;
+    flipper_golden_close(&ctx->hash_check);
+    gpio_exit(ctx, FL_EXIT_GOLDEN_MISMATCH);
+}
+
+static void golden_frame(FLIPPER_CTX* ctx) {
+    uint64_t hash = flipper_hash64(ctx->lcd_buffer, FL_LCD_BUFFER_SIZE, 0);
+    if (ctx->hash_record.file)
+        flipper_golden_write(&ctx->hash_record, hash);
+    if (!ctx->hash_check.file)
+        return;
+
+    uint64_t expected;
+    if (!flipper_golden_read(&ctx->hash_check, &expected)) {
+        printf("flipper_hash_check: %s ends before frame %u\n", ctx->hash_check_path,
+               ctx->frame_count);
+        golden_fail(ctx);
+    } else if (hash != expected) {
+        printf("flipper_hash_check: frame %u differs from %s\n", ctx->frame_count,
+               ctx->hash_check_path);
+        golden_dump(ctx, ctx->frame_count);
+        golden_fail(ctx);
+    }
+}
+
+// an app that stopped early has hashes left over
+static void golden_finish(FLIPPER_CTX* ctx) {
+    uint64_t expected;
+    if (ctx->hash_check.file && flipper_golden_read(&ctx->hash_check, &expected)) {
+        printf("flipper_hash_check: app ended after frame %u, %s goes on\n", ctx->frame_count,
+               ctx->hash_check_path);
+        ctx->golden_failed = true;
+    }
+    flipper_golden_close(&ctx->hash_check);
+}
+
+bool flipper_ctx_hash_failed(FLIPPER_CTX* ctx) {
+    golden_finish(ctx);
+    return ctx->golden_failed;
+}
+
+bool flipper_ctx_capture_start(FLIPPER_CTX* ctx, const char* path, int flags) {
+    flipper_ctx_capture_stop(ctx);
+    ctx->capture = flipper_capture_create(ctx, path, flags);
+    return ctx->capture != NULL;
+}
+
+void flipper_ctx_capture_stop(FLIPPER_CTX* ctx) {
+    flipper_capture_destroy(ctx->capture);
+    ctx->capture = NULL;
+}
+
+bool flipper_ctx_shm_start(FLIPPER_CTX* ctx, const char* name, int flags) {
+    flipper_ctx_shm_stop(ctx);
+    ctx->shm = flipper_shm_create(name, flags);
+    return ctx->shm != NULL;
+}
+
+void flipper_ctx_shm_stop(FLIPPER_CTX* ctx) {
+    flipper_shm_destroy(ctx->shm);
+    ctx->shm = NULL;
+}
+
+static uint32_t random_next(FLIPPER_RANDOM* rng) {
+    uint64_t old = rng->state;
+    rng->state = old * RANDOM_MULTIPLIER + RANDOM_INCREMENT;
+
+    uint32_t xorshifted = (uint32_t)(((old >> 18) ^ old) >> 27);
+    uint32_t rot = (uint32_t)(old >> 59);
+    return (xorshifted >> rot) | (xorshifted << ((0 - rot) & 31));
+}
+
+void flipper_ctx_random_seed(FLIPPER_CTX* ctx, uint64_t seed) {
+    FLIPPER_RANDOM* rng = &ctx->rng;
+    rng->seed = seed;
+    rng->state = 0;
+    random_next(rng);
+    rng->state += seed;
+    random_next(rng);
+}
+
+uint64_t flipper_ctx_random_get_seed(FLIPPER_CTX* ctx) {
+    return ctx->rng.seed;
+}
+
+// uniform in 0..range-1 without modulo bias (Lemire's multiply and reject)
+int flipper_ctx_random(FLIPPER_CTX* ctx, int range) {
+    if (range <= 0)
+        return 0;
+
+    uint32_t bound = (uint32_t)range;
+    uint64_t m = (uint64_t)random_next(&ctx->rng) * bound;
+    if ((uint32_t)m < bound) {
+        uint32_t threshold = (0 - bound) % bound;
+        while ((uint32_t)m < threshold) {
+            m = (uint64_t)random_next(&ctx->rng) * bound;
+        }
+    }
+    return (int)(m >> 32);
+}
+
+int flipper_ctx_get_tics(FLIPPER_CTX* ctx) {
+    if (ctx->virtual_clock)
+        return ctx->virtual_base + (int32_t)((uint64_t)ctx->virtual_frames * 1000 / ctx->fps);
     return SDL_GetTicks();
-}
\ No newline at end of file
+}
+
+////////////////////////////////////////////////////////////////
+// default context
+
+bool flipper_init(int flags) {
+    // an instance made current by a host (e.g. the batch runner) is already set up, only the
+    // flags about how the app reads it apply
+    if (current_ctx != &default_ctx) {
+        current_ctx->ui_rotate = (flags & FL_INIT_SIMULATOR_ROTATE) != 0;
+        current_ctx->events_enabled = (flags & FL_INIT_EVENTS) != 0;
+        return true;
+    }
+
+    // the simulator can be switched to batch operation without rebuilding the app
+    if (env_int("FLIPPER_SIM_HEADLESS", 0))
+        flags |= FL_INIT_HEADLESS;
+    if (env_int("FLIPPER_SIM_VIRTUAL_CLOCK", 0))
+        flags |= FL_INIT_VIRTUAL_CLOCK;
+    if (env_int("FLIPPER_SIM_STATS", 0))
+        flags |= FL_INIT_STATS;
+    if (env_int("FLIPPER_SIM_ACCELERATED", 0))
+        flags |= FL_INIT_ACCELERATED;
+    if (env_int("FLIPPER_SIM_VSYNC", 0))
+        flags |= FL_INIT_VSYNC;
+
+    // benchmark: uncapped frames with phase times, allocations are counted from SDL_Init on
+    int bench_frames = env_int("FLIPPER_SIM_BENCH", 0);
+    if (bench_frames > 0) {
+        flags |= FL_INIT_VIRTUAL_CLOCK | FL_INIT_STATS;
+        flipper_bench_count_allocations();
+    }
+
+    FLIPPER_CTX* ctx = current_ctx;
+    if (!ctx_init(ctx, flags))
+        return false;
+
+    flipper_ctx_set_frame_limit(ctx, env_int("FLIPPER_SIM_FRAMES", 0));
+    flipper_ctx_lcd_set_fps(ctx, env_int("FLIPPER_SIM_FPS", DEFAULT_FPS));
+    flipper_ctx_lcd_set_pacing(ctx, env_int("FLIPPER_SIM_PACING", FL_PACE_DROP));
+    if (bench_frames > 0) {
+        flipper_ctx_set_frame_limit(ctx, bench_frames);
+        flipper_ctx_random_seed(ctx, BENCH_SEED);
+    }
+
+    const char* seed = getenv("FLIPPER_SIM_SEED");
+    if (seed && *seed)
+        flipper_ctx_random_seed(ctx, strtoull(seed, NULL, 0));
+
+    const char* replay_path = getenv("FLIPPER_SIM_REPLAY");
+    if (replay_path && *replay_path && !flipper_ctx_input_replay(ctx, replay_path))
+        return false;
+
+    const char* record_path = getenv("FLIPPER_SIM_RECORD");
+    if (record_path && *record_path && !flipper_ctx_input_record(ctx, record_path))
+        return false;
+
+    const char* hash_record_path = getenv("FLIPPER_SIM_HASH_RECORD");
+    if (hash_record_path && *hash_record_path && !flipper_ctx_hash_record(ctx, hash_record_path))
+        return false;
+
+    const char* hash_check_path = getenv("FLIPPER_SIM_HASH_CHECK");
+    if (hash_check_path && *hash_check_path && !flipper_ctx_hash_check(ctx, hash_check_path))
+        return false;
+
+    const char* capture_path = getenv("FLIPPER_SIM_CAPTURE");
+    int capture_flags = env_int("FLIPPER_SIM_CAPTURE_SKIN", 0) ? FL_CAPTURE_SKIN : 0;
+    if (capture_path && *capture_path &&
+        !flipper_ctx_capture_start(ctx, capture_path, capture_flags))
+        return false;
+
+    const char* shm_name = getenv("FLIPPER_SIM_SHM");
+    int shm_flags = env_int("FLIPPER_SIM_SHM_REPLACE", 0) ? FL_SHM_REPLACE : 0;
+    if (shm_name && *shm_name && !flipper_ctx_shm_start(ctx, shm_name, shm_flags))
+        return false;
+
+    if (bench_frames > 0)
+        flipper_bench_start(&ctx->bench);
+    return true;
+}
+
+void flipper_close() {
+    if (current_ctx != &default_ctx)
+        return;
+
+    flipper_ctx_stats_print(current_ctx);
+    if (current_ctx->bench.enabled) {
+        flipper_bench_report(&current_ctx->bench, &current_ctx->stats,
+                             current_ctx->frame_count);
+    }
+    if (current_ctx->events_dropped)
+        printf("flipper_close: %u input events dropped\n", current_ctx->events_dropped);
+    golden_finish(current_ctx);
+    bool golden_failed = current_ctx->golden_failed;
+    ctx_close(current_ctx);
+    if (!current_ctx->headless)
+        SDL_Quit();
+
+    // the app can't report it, fail the process for scripts comparing against a golden file
+    if (golden_failed)
+        exit(1);
+}
+
+void flipper_set_frame_limit(int frames) {
+    flipper_ctx_set_frame_limit(current_ctx, frames);
+}
+
+bool flipper_stats_get(int phase, FLIPPER_PHASE_STATS* stats) {
+    return flipper_ctx_stats_get(current_ctx, phase, stats);
+}
+
+void flipper_stats_print() {
+    flipper_ctx_stats_print(current_ctx);
+}
+
+void flipper_set_score(int score) {
+    flipper_ctx_set_score(current_ctx, score);
+}
+
+int flipper_get_tics() {
+    return flipper_ctx_get_tics(current_ctx);
+}
+
+int flipper_random(int range) {
+    return flipper_ctx_random(current_ctx, range);
+}
+
+void flipper_random_seed(uint64_t seed) {
+    flipper_ctx_random_seed(current_ctx, seed);
+}
+
+uint64_t flipper_random_get_seed() {
+    return flipper_ctx_random_get_seed(current_ctx);
+}
+
+void flipper_gpio_update() {
+    flipper_ctx_gpio_update(current_ctx);
+}
+
+bool flipper_gpio_get(int pin) {
+    return flipper_ctx_gpio_get(current_ctx, pin);
+}
+
+void flipper_gpio_set(int pin) {
+    flipper_ctx_gpio_set(current_ctx, pin);
+}
+
+int flipper_key_get_time(int pin) {
+    return flipper_ctx_key_get_time(current_ctx, pin);
+}
+
+uint64_t flipper_get_time_us() {
+    return flipper_ctx_get_time_us(current_ctx);
+}
+
+bool flipper_event_get(FLIPPER_EVENT* event) {
+    return flipper_ctx_event_get(current_ctx, event);
+}
+
+bool flipper_input_record(const char* path) {
+    return flipper_ctx_input_record(current_ctx, path);
+}
+
+bool flipper_input_replay(const char* path) {
+    return flipper_ctx_input_replay(current_ctx, path);
+}
+
+bool flipper_hash_record(const char* path) {
+    return flipper_ctx_hash_record(current_ctx, path);
+}
+
+bool flipper_hash_check(const char* path) {
+    return flipper_ctx_hash_check(current_ctx, path);
+}
+
+bool flipper_capture_start(const char* path, int flags) {
+    return flipper_ctx_capture_start(current_ctx, path, flags);
+}
+
+void flipper_capture_stop() {
+    flipper_ctx_capture_stop(current_ctx);
+}
+
+bool flipper_shm_start(const char* name, int flags) {
+    return flipper_ctx_shm_start(current_ctx, name, flags);
+}
+
+void flipper_shm_stop() {
+    flipper_ctx_shm_stop(current_ctx);
+}
+
+void flipper_pixel_set(int x, int y) {
+    flipper_ctx_pixel_set(current_ctx, x, y);
+}
+
+void flipper_pixel_clear(int x, int y) {
+    flipper_ctx_pixel_clear(current_ctx, x, y);
+}
+
+bool flipper_pixel_get(int x, int y) {
+    return flipper_ctx_pixel_get(current_ctx, x, y);
+}
+
+void flipper_pixel_reset() {
+    flipper_ctx_pixel_reset(current_ctx);
+}
+
+void flipper_lcd_update() {
+    flipper_ctx_lcd_update(current_ctx);
+}
+
+void flipper_lcd_constant_fps() {
+    flipper_ctx_lcd_constant_fps(current_ctx);
+}
+
+void flipper_lcd_set_fps(int fps) {
+    flipper_ctx_lcd_set_fps(current_ctx, fps);
+}
+
+int flipper_lcd_get_fps() {
+    return flipper_ctx_lcd_get_fps(current_ctx);
+}
+
+void flipper_lcd_set_pacing(int policy) {
+    flipper_ctx_lcd_set_pacing(current_ctx, policy);
+}
+
+int flipper_lcd_get_late_frames() {
+    return flipper_ctx_lcd_get_late_frames(current_ctx);
+}
+
+int flipper_lcd_get_dropped_frames() {
+    return flipper_ctx_lcd_get_dropped_frames(current_ctx);
+}
@@ -6,7 +6,17 @@
 #define FL_LCD_WIDTH 128
 #define FL_LCD_HEIGHT 64
 
+// lcd memory is organized in pages of 8 rows like on the ST7565 controller:
+// one byte holds a column of 8 vertical pixels, bit 0 is the top row
+#define FL_LCD_PAGES (FL_LCD_HEIGHT / 8)
+
 #define FL_INIT_SIMULATOR_ROTATE 1
+#define FL_INIT_HEADLESS 2  // no window and no frame pacing, only the lcd memory is updated
+#define FL_INIT_VIRTUAL_CLOCK 4  // tics advance per frame instead of with wall time, no sleeping
+#define FL_INIT_STATS 8          // measure frame phases, see flipper_stats_get
+#define FL_INIT_ACCELERATED 16   // gpu renderer, falls back to software if there is none
+#define FL_INIT_VSYNC 32         // present synced to the display refresh
+#define FL_INIT_EVENTS 64        // queue every gpio change, see flipper_event_get
 
 #define FL_GPIO_BUTTON_UP 0
 #define FL_GPIO_BUTTON_LEFT 1
@@ -18,11 +28,22 @@
 #define FL_GPIO_SIMULATOR_EXIT 63  // must be highest value
 #define FL_GPIO_COUNT (FL_GPIO_SIMULATOR_EXIT + 1)
 
+// why FL_GPIO_SIMULATOR_EXIT was raised
+#define FL_EXIT_NONE 0
+#define FL_EXIT_USER 1             // window closed or quit key
+#define FL_EXIT_FRAME_LIMIT 2      // see flipper_set_frame_limit
+#define FL_EXIT_REPLAY_END 3       // input log played back completely
+#define FL_EXIT_GOLDEN_MISMATCH 4  // a frame differs from flipper_hash_check
+
 bool flipper_init(int flags);
 void flipper_close();
 
 int flipper_get_tics();
-int flipper_random(int range);
+int flipper_random(int range);  // 0..range-1
+
+// the same seed gives the same flipper_random sequence, also available as FLIPPER_SIM_SEED
+void flipper_random_seed(uint64_t seed);
+uint64_t flipper_random_get_seed();
 
 void flipper_gpio_update();
 bool flipper_gpio_get(int pin);
@@ -30,11 +51,196 @@ void flipper_gpio_set(int pin);
 
 int flipper_key_get_time(int pin);
 
+// microseconds since flipper_init, advances by one frame interval per frame on the virtual clock
+uint64_t flipper_get_time_us();
+
+// one gpio change, see flipper_event_get
+typedef struct FLIPPER_EVENT FLIPPER_EVENT;
+struct FLIPPER_EVENT {
+    uint64_t time_us;  // flipper_get_time_us when the key changed
+    int pin;           // FL_GPIO_*
+    bool down;
+};
+
+// takes the oldest gpio change not consumed yet, false if there is none. Changes are only
+// queued with FL_INIT_EVENTS, then an app sees every press and release even if both happened
+// between two flipper_gpio_update calls. flipper_gpio_get keeps returning the latest state.
+bool flipper_event_get(FLIPPER_EVENT* event);
+
+// record gpio changes and the random seed to a file, or play them back instead of the keyboard.
+// call right after flipper_init, also available as FLIPPER_SIM_RECORD / FLIPPER_SIM_REPLAY
+bool flipper_input_record(const char* path);
+bool flipper_input_replay(const char* path);
+
+// write the XXH64 of every frame's lcd to a file, or compare every frame against such a file
+// using the random seed recorded in it. The first frame that differs is dumped as
+// <path>.<frame>.pbm and raises the exit pin with FL_EXIT_GOLDEN_MISMATCH, flipper_close then
+// exits the process with status 1. Also available as FLIPPER_SIM_HASH_RECORD /
+// FLIPPER_SIM_HASH_CHECK
+bool flipper_hash_record(const char* path);
+bool flipper_hash_check(const char* path);
+
+// stream every frame passed to flipper_lcd_update to an animated gif (path ends with .gif) or
+// to png files (path is a printf pattern for the frame number, e.g. "frames/%05d.png"),
+// encoded on a background thread. Also available as FLIPPER_SIM_CAPTURE / FLIPPER_SIM_CAPTURE_SKIN
+#define FL_CAPTURE_SKIN 1  // the whole window instead of the lcd, needs a window
+bool flipper_capture_start(const char* path, int flags);
+void flipper_capture_stop();  // finishes the file, also done by flipper_close
+
+// publish every frame passed to flipper_lcd_update into a shared-memory ring named like
+// "/flipper", for viewers and test rigs in other processes, and apply the button changes
+// they write into its input mailbox in flipper_gpio_update. See flipper_shm.h for the
+// layout. Also available as FLIPPER_SIM_SHM / FLIPPER_SIM_SHM_REPLACE
+#define FL_SHM_REPLACE 1  // take over an existing object, e.g. one left by a crashed process
+bool flipper_shm_start(const char* name, int flags);
+void flipper_shm_stop();  // removes the object, also done by flipper_close
+
 void flipper_pixel_set(int x, int y);
 void flipper_pixel_clear(int x, int y);
 bool flipper_pixel_get(int x, int y);
 
 void flipper_pixel_reset();
 
+// how the drawing primitives combine their pixels with the lcd
+#define FL_DRAW_OR 0     // set pixels
+#define FL_DRAW_AND 1    // keep only pixels also set in the source (sprites, no-op for shapes)
+#define FL_DRAW_XOR 2    // invert pixels
+#define FL_DRAW_CLEAR 3  // clear pixels
+
+// 1bpp image in lcd layout: (height + 7) / 8 pages of width bytes, bit 0 is the top row
+typedef struct FLIPPER_SPRITE FLIPPER_SPRITE;
+struct FLIPPER_SPRITE {
+    int width;
+    int height;
+    const uint8_t* data;
+};
+
+// primitives are clipped to the lcd once and then write whole bytes, much faster than
+// the same shapes drawn with flipper_pixel_set
+void flipper_draw_hline(int x, int y, int width, int mode);
+void flipper_draw_vline(int x, int y, int height, int mode);
+void flipper_draw_fill_rect(int x, int y, int width, int height, int mode);
+void flipper_draw_rect(int x, int y, int width, int height, int mode);  // outline
+void flipper_draw_blit(int x, int y, const FLIPPER_SPRITE* sprite, int mode);
+
+// text in the built in 4x6 font (ascii 0..127), every glyph is an opaque cell
+#define FL_FONT_WIDTH 4
+#define FL_FONT_HEIGHT 6
+
+#define FL_TEXT_INVERT 1  // light text on a dark box
+#define FL_TEXT_ROTATE 2  // for FL_INIT_SIMULATOR_ROTATE: x and y are swapped, the text runs down
+
+// draws s with its first glyph at x, y and returns the x after the last glyph
+int flipper_text_draw(int x, int y, const char* s, int flags);
+// draws value in decimal ending at right and returns the x of its first glyph
+int flipper_text_draw_int(int right, int y, int value, int flags);
+
 void flipper_lcd_update();
-void flipper_lcd_constant_fps();
\ No newline at end of file
+void flipper_lcd_constant_fps();
+
+// what flipper_lcd_constant_fps does when a frame took longer than 1 / fps
+#define FL_PACE_DROP 0      // skip the missed frame slots (default)
+#define FL_PACE_CATCH_UP 1  // keep the schedule, run frames without waiting until it is met
+#define FL_PACE_RESET 2     // start a new schedule at the late frame
+
+// frame rate of flipper_lcd_constant_fps and the virtual clock, default 25,
+// also available as FLIPPER_SIM_FPS / FLIPPER_SIM_PACING
+void flipper_lcd_set_fps(int fps);
+int flipper_lcd_get_fps();
+void flipper_lcd_set_pacing(int policy);
+int flipper_lcd_get_late_frames();     // frames that ended after their deadline
+int flipper_lcd_get_dropped_frames();  // frame slots skipped by FL_PACE_DROP
+
+// frame phases measured with FL_INIT_STATS (or FLIPPER_SIM_STATS=1)
+#define FL_PHASE_APP 0         // app code between two frames
+#define FL_PHASE_BACKGROUND 1  // copy of the cached ui skin to the window
+#define FL_PHASE_HIGHLIGHT 2   // button highlights composited into the skin
+#define FL_PHASE_UPLOAD 3      // lcd blit into the skin and texture upload
+#define FL_PHASE_PRESENT 4     // SDL_RenderPresent
+#define FL_PHASE_SLEEP 5       // flipper_lcd_constant_fps
+#define FL_PHASE_FRAME 6       // start to start of flipper_lcd_update
+#define FL_PHASE_COUNT 7
+
+typedef struct FLIPPER_PHASE_STATS FLIPPER_PHASE_STATS;
+struct FLIPPER_PHASE_STATS {
+    const char* name;
+    int samples;  // the last 1024 frames at most
+    double mean_us;
+    uint32_t p50_us;
+    uint32_t p99_us;
+    uint32_t max_us;
+};
+
+bool flipper_stats_get(int phase, FLIPPER_PHASE_STATS* stats);
+void flipper_stats_print();  // also printed by flipper_close when enabled
+
+void flipper_set_frame_limit(int frames);  // raise FL_GPIO_SIMULATOR_EXIT after n frames, 0 = off
+void flipper_set_score(int score);         // current game score, reported by batch runs
+
+// Simulator instances. Every function above operates on a default instance created by
+// flipper_init, the flipper_ctx_* variants on an instance of their own, so several
+// simulated devices can run in one process.
+typedef struct FLIPPER_CTX FLIPPER_CTX;
+
+FLIPPER_CTX* flipper_ctx_create(int flags);
+void flipper_ctx_destroy(FLIPPER_CTX* ctx);
+
+// make ctx the instance used by the functions without context in the calling thread,
+// NULL selects the default instance again. flipper_init / flipper_close leave an instance
+// made current this way alone, so an unmodified app can run on it.
+void flipper_ctx_make_current(FLIPPER_CTX* ctx);
+
+void flipper_ctx_set_frame_limit(FLIPPER_CTX* ctx, int frames);
+int flipper_ctx_get_frame_count(FLIPPER_CTX* ctx);
+int flipper_ctx_get_exit_reason(FLIPPER_CTX* ctx);
+void flipper_ctx_set_score(FLIPPER_CTX* ctx, int score);
+int flipper_ctx_get_score(FLIPPER_CTX* ctx);
+
+bool flipper_ctx_stats_get(FLIPPER_CTX* ctx, int phase, FLIPPER_PHASE_STATS* stats);
+void flipper_ctx_stats_print(FLIPPER_CTX* ctx);
+
+int flipper_ctx_get_tics(FLIPPER_CTX* ctx);
+int flipper_ctx_random(FLIPPER_CTX* ctx, int range);
+void flipper_ctx_random_seed(FLIPPER_CTX* ctx, uint64_t seed);
+uint64_t flipper_ctx_random_get_seed(FLIPPER_CTX* ctx);
+
+void flipper_ctx_gpio_update(FLIPPER_CTX* ctx);
+bool flipper_ctx_gpio_get(FLIPPER_CTX* ctx, int pin);
+void flipper_ctx_gpio_set(FLIPPER_CTX* ctx, int pin);
+
+int flipper_ctx_key_get_time(FLIPPER_CTX* ctx, int pin);
+uint64_t flipper_ctx_get_time_us(FLIPPER_CTX* ctx);
+bool flipper_ctx_event_get(FLIPPER_CTX* ctx, FLIPPER_EVENT* event);
+
+bool flipper_ctx_input_record(FLIPPER_CTX* ctx, const char* path);
+bool flipper_ctx_input_replay(FLIPPER_CTX* ctx, const char* path);
+bool flipper_ctx_hash_record(FLIPPER_CTX* ctx, const char* path);
+bool flipper_ctx_hash_check(FLIPPER_CTX* ctx, const char* path);
+bool flipper_ctx_hash_failed(FLIPPER_CTX* ctx);  // a frame differed or the app stopped early
+bool flipper_ctx_capture_start(FLIPPER_CTX* ctx, const char* path, int flags);
+void flipper_ctx_capture_stop(FLIPPER_CTX* ctx);
+bool flipper_ctx_shm_start(FLIPPER_CTX* ctx, const char* name, int flags);
+void flipper_ctx_shm_stop(FLIPPER_CTX* ctx);
+
+void flipper_ctx_pixel_set(FLIPPER_CTX* ctx, int x, int y);
+void flipper_ctx_pixel_clear(FLIPPER_CTX* ctx, int x, int y);
+bool flipper_ctx_pixel_get(FLIPPER_CTX* ctx, int x, int y);
+
+void flipper_ctx_pixel_reset(FLIPPER_CTX* ctx);
+
+void flipper_ctx_draw_hline(FLIPPER_CTX* ctx, int x, int y, int width, int mode);
+void flipper_ctx_draw_vline(FLIPPER_CTX* ctx, int x, int y, int height, int mode);
+void flipper_ctx_draw_fill_rect(FLIPPER_CTX* ctx, int x, int y, int width, int height, int mode);
+void flipper_ctx_draw_rect(FLIPPER_CTX* ctx, int x, int y, int width, int height, int mode);
+void flipper_ctx_draw_blit(FLIPPER_CTX* ctx, int x, int y, const FLIPPER_SPRITE* sprite,
+                           int mode);
+int flipper_ctx_text_draw(FLIPPER_CTX* ctx, int x, int y, const char* s, int flags);
+int flipper_ctx_text_draw_int(FLIPPER_CTX* ctx, int right, int y, int value, int flags);
+
+void flipper_ctx_lcd_update(FLIPPER_CTX* ctx);
+void flipper_ctx_lcd_constant_fps(FLIPPER_CTX* ctx);
+void flipper_ctx_lcd_set_fps(FLIPPER_CTX* ctx, int fps);
+int flipper_ctx_lcd_get_fps(FLIPPER_CTX* ctx);
+void flipper_ctx_lcd_set_pacing(FLIPPER_CTX* ctx, int policy);
+int flipper_ctx_lcd_get_late_frames(FLIPPER_CTX* ctx);
+int flipper_ctx_lcd_get_dropped_frames(FLIPPER_CTX* ctx);
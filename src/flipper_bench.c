@@ -0,0 +1,123 @@
+#include "flipper_bench.h"
+
+#include <stdio.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+// the script holds a random direction for a few frames, back restarts a game that is over
+#define SCRIPT_STEP 6
+#define SCRIPT_BACK_STEPS 100
+#define SCRIPT_SEED 0x9e3779b97f4a7c15ull
+
+static const int script_buttons[] = { FL_GPIO_BUTTON_UP, FL_GPIO_BUTTON_LEFT,
+                                      FL_GPIO_BUTTON_DOWN, FL_GPIO_BUTTON_RIGHT };
+
+static SDL_malloc_func sdl_malloc;
+static SDL_calloc_func sdl_calloc;
+static SDL_realloc_func sdl_realloc;
+static SDL_free_func sdl_free;
+static SDL_atomic_t allocations;
+static bool counting;
+
+static void* SDLCALL count_malloc(size_t size) {
+    SDL_AtomicAdd(&allocations, 1);
+    return sdl_malloc(size);
+}
+
+static void* SDLCALL count_calloc(size_t count, size_t size) {
+    SDL_AtomicAdd(&allocations, 1);
+    return sdl_calloc(count, size);
+}
+
+static void* SDLCALL count_realloc(void* mem, size_t size) {
+    SDL_AtomicAdd(&allocations, 1);
+    return sdl_realloc(mem, size);
+}
+
+void flipper_bench_count_allocations() {
+    if (counting)
+        return;
+    SDL_GetMemoryFunctions(&sdl_malloc, &sdl_calloc, &sdl_realloc, &sdl_free);
+    counting = SDL_SetMemoryFunctions(count_malloc, count_calloc, count_realloc, sdl_free) == 0;
+}
+
+void flipper_bench_start(FLIPPER_BENCH* bench) {
+    bench->enabled = true;
+    bench->start = SDL_GetPerformanceCounter();
+    bench->allocations = SDL_AtomicGet(&allocations);
+    bench->script = SCRIPT_SEED;
+    bench->script_pin = -1;
+}
+
+// splitmix64
+static uint64_t script_next(FLIPPER_BENCH* bench) {
+    uint64_t z = (bench->script += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+void flipper_bench_script(FLIPPER_BENCH* bench, uint32_t frame, int* release, int* press) {
+    *release = -1;
+    *press = -1;
+    if (frame % SCRIPT_STEP != 0)
+        return;
+
+    *release = bench->script_pin;
+    uint32_t step = frame / SCRIPT_STEP;
+    if (step % SCRIPT_BACK_STEPS == SCRIPT_BACK_STEPS - 1)
+        *press = FL_GPIO_BUTTON_BACK;
+    else
+        *press = script_buttons[script_next(bench) % 4];
+    bench->script_pin = *press;
+}
+
+static uint64_t peak_rss_kib() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!K32GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return 0;
+    return counters.PeakWorkingSetSize / 1024;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+#ifdef __APPLE__
+    return (uint64_t)usage.ru_maxrss / 1024;  // bytes on macOS
+#else
+    return (uint64_t)usage.ru_maxrss;
+#endif
+#endif
+}
+
+void flipper_bench_report(const FLIPPER_BENCH* bench, const FLIPPER_STATS* stats,
+                          uint32_t frames) {
+    double seconds =
+        (double)(SDL_GetPerformanceCounter() - bench->start) / (double)stats->frequency;
+    printf("bench: %u frames in %.3f s, %.0f frames/s\n", frames, seconds,
+           seconds > 0 ? frames / seconds : 0);
+    if (frames == 0)
+        return;
+
+    // phases that only run in some frames are spread over all of them, so they add up to frame
+    printf("bench: ns/frame");
+    for (int phase = 0; phase < FL_PHASE_COUNT; phase++) {
+        if (stats->count[phase] == 0)
+            continue;
+        double ns = (double)stats->total[phase] * 1e9 / (double)stats->frequency / frames;
+        printf(" %s %.0f", flipper_stats_phase_name(phase), ns);
+    }
+    printf("\n");
+
+    printf("bench: peak rss %llu KiB", (unsigned long long)peak_rss_kib());
+    if (counting) {
+        int n = SDL_AtomicGet(&allocations) - bench->allocations;
+        printf(", %d SDL_malloc allocations (%.3f/frame)", n, (double)n / frames);
+    }
+    printf("\n");
+}
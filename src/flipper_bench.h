@@ -0,0 +1,31 @@
+#pragma once
+
+// Whole-app benchmark (FLIPPER_SIM_BENCH=N): the unchanged app runs for N frames on the
+// virtual clock, driven by a replay or by a fixed input script, and the throughput is
+// printed at flipper_close.
+
+#include <SDL.h>
+
+#include "flipper_stats.h"
+
+typedef struct FLIPPER_BENCH FLIPPER_BENCH;
+struct FLIPPER_BENCH {
+    bool enabled;
+    uint64_t start;    // performance counter when the app loop starts
+    int allocations;   // allocations counted before the start
+    uint64_t script;   // random state of the input script
+    int script_pin;    // button held by the script, -1 if none
+};
+
+// counts allocations made through SDL_malloc from now on, by SDL and the simulator. The app's
+// own malloc calls and libraries calling malloc directly (e.g. libpng) are not counted.
+// Only works before SDL allocates anything
+void flipper_bench_count_allocations();
+
+void flipper_bench_start(FLIPPER_BENCH* bench);
+
+// button changes of the input script at a frame, -1 for none
+void flipper_bench_script(FLIPPER_BENCH* bench, uint32_t frame, int* release, int* press);
+
+void flipper_bench_report(const FLIPPER_BENCH* bench, const FLIPPER_STATS* stats,
+                          uint32_t frames);
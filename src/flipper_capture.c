@@ -0,0 +1,466 @@
+#include "flipper_capture.h"
+
+#include <SDL_image.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "flipper_ctx.h"
+
+#define GIF_MAX_CODE 4095
+#define GIF_HASH_SIZE 5003  // prime above GIF_MAX_CODE
+
+typedef struct CAPTURE_FRAME CAPTURE_FRAME;
+struct CAPTURE_FRAME {
+    bool end;  // no more frames, finish the file
+    uint32_t frame;
+    uint64_t start_us;  // since the first captured frame
+    uint64_t end_us;
+    uint32_t highlights;
+    uint8_t lcd[FL_LCD_BUFFER_SIZE];
+};
+
+struct FLIPPER_CAPTURE {
+    FLIPPER_CTX* ctx;
+    bool skin;
+    bool gif;
+    char* path;  // gif file or png file name pattern
+    int width;
+    int height;
+
+    // bounded queue between flipper_lcd_update and the encoder thread, free counts the
+    // empty slots and filled the queued frames
+    CAPTURE_FRAME queue[FLIPPER_CAPTURE_QUEUE_SIZE];
+    int head;  // producer only
+    int tail;  // encoder only
+    SDL_sem* free;
+    SDL_sem* filled;
+    SDL_Thread* thread;
+
+    uint64_t time_us;  // producer only, start of the next frame
+
+    // encoder only
+    uint32_t* pixels;  // ARGB of the frame being encoded
+    uint32_t* shown;   // ARGB of the last frame that changed
+    uint8_t* indices;  // palette indices for the gif image
+    bool have_frame;   // shown and pending are valid
+    SDL_Rect pending;  // changed area of shown, written when its duration is known
+    uint64_t pending_us;
+    uint64_t end_us;  // end of the last frame
+
+    FILE* file;
+    uint32_t palette[256];
+    int palette_bits;
+
+    // lzw state of the gif image being written
+    int32_t hash_key[GIF_HASH_SIZE];
+    int16_t hash_code[GIF_HASH_SIZE];
+    uint8_t block[255];
+    int block_size;
+    uint32_t bits;
+    int num_bits;
+};
+
+////////////////////////////////////////////////////////////////
+// gif, see https://www.w3.org/Graphics/GIF/spec-gif89a.txt
+
+static void gif_u16(FILE* f, int v) {
+    fputc(v & 0xff, f);
+    fputc((v >> 8) & 0xff, f);
+}
+
+static void gif_flush_block(FLIPPER_CAPTURE* c) {
+    if (c->block_size == 0)
+        return;
+    fputc(c->block_size, c->file);
+    fwrite(c->block, 1, c->block_size, c->file);
+    c->block_size = 0;
+}
+
+static void gif_code(FLIPPER_CAPTURE* c, int code, int size) {
+    c->bits |= (uint32_t)code << c->num_bits;
+    c->num_bits += size;
+    while (c->num_bits >= 8) {
+        c->block[c->block_size++] = (uint8_t)c->bits;
+        if (c->block_size == 255)
+            gif_flush_block(c);
+        c->bits >>= 8;
+        c->num_bits -= 8;
+    }
+}
+
+static void gif_start(FLIPPER_CAPTURE* c) {
+    FILE* f = c->file;
+    fwrite("GIF89a", 1, 6, f);
+    gif_u16(f, c->width);
+    gif_u16(f, c->height);
+    fputc(0x80 | (c->palette_bits - 1), f);  // global color table
+    fputc(0, f);                             // background color
+    fputc(0, f);                             // aspect ratio
+    for (int i = 0; i < 1 << c->palette_bits; i++) {
+        fputc((c->palette[i] >> 16) & 0xff, f);
+        fputc((c->palette[i] >> 8) & 0xff, f);
+        fputc(c->palette[i] & 0xff, f);
+    }
+
+    // loop forever
+    fputc(0x21, f);
+    fputc(0xff, f);
+    fputc(11, f);
+    fwrite("NETSCAPE2.0", 1, 11, f);
+    fputc(3, f);
+    fputc(1, f);
+    gif_u16(f, 0);
+    fputc(0, f);
+}
+
+// the r area of c->indices as one image, shown for delay 1/100 s
+static void gif_image(FLIPPER_CAPTURE* c, const SDL_Rect* r, int delay) {
+    FILE* f = c->file;
+
+    // graphic control: keep the previous frame below, no transparency
+    fputc(0x21, f);
+    fputc(0xf9, f);
+    fputc(4, f);
+    fputc(1 << 2, f);
+    gif_u16(f, delay);
+    fputc(0, f);
+    fputc(0, f);
+
+    fputc(0x2c, f);
+    gif_u16(f, r->x);
+    gif_u16(f, r->y);
+    gif_u16(f, r->w);
+    gif_u16(f, r->h);
+    fputc(0, f);
+
+    // lzw with variable code size, the table is cleared when it is full
+    int min_size = c->palette_bits < 2 ? 2 : c->palette_bits;
+    int clear = 1 << min_size;
+    int end = clear + 1;
+    int size = min_size + 1;
+    int next_code = clear + 2;
+    fputc(min_size, f);
+    c->block_size = 0;
+    c->bits = 0;
+    c->num_bits = 0;
+    memset(c->hash_key, 0xff, sizeof(c->hash_key));
+    gif_code(c, clear, size);
+
+    int prefix = -1;
+    for (int y = r->y; y < r->y + r->h; y++) {
+        const uint8_t* row = &c->indices[y * c->width];
+        for (int x = r->x; x < r->x + r->w; x++) {
+            int k = row[x];
+            if (prefix < 0) {
+                prefix = k;
+                continue;
+            }
+
+            int32_t key = (prefix << 8) | k;
+            int h = key % GIF_HASH_SIZE;
+            while (c->hash_key[h] >= 0 && c->hash_key[h] != key)
+                h = h + 1 == GIF_HASH_SIZE ? 0 : h + 1;
+            if (c->hash_key[h] == key) {
+                prefix = c->hash_code[h];
+                continue;
+            }
+
+            gif_code(c, prefix, size);
+            if (next_code <= GIF_MAX_CODE) {
+                c->hash_key[h] = key;
+                c->hash_code[h] = (int16_t)next_code;
+                // the decoder grows its code size one code later than the encoder
+                if (next_code == 1 << size && size < 12)
+                    size++;
+                next_code++;
+            } else {
+                gif_code(c, clear, size);
+                memset(c->hash_key, 0xff, sizeof(c->hash_key));
+                size = min_size + 1;
+                next_code = clear + 2;
+            }
+            prefix = k;
+        }
+    }
+    gif_code(c, prefix, size);
+    gif_code(c, end, size);
+    if (c->num_bits > 0)
+        gif_code(c, 0, 8 - c->num_bits);
+    gif_flush_block(c);
+    fputc(0, f);
+}
+
+////////////////////////////////////////////////////////////////
+
+// the frame as the window shows it, or only the lcd at 1x (transposed like the window if
+// the ui is rotated)
+static void frame_pixels(FLIPPER_CAPTURE* c, const CAPTURE_FRAME* frame) {
+    FLIPPER_CTX* ctx = c->ctx;
+    if (c->skin) {
+        flipper_ctx_skin_compose(ctx, c->pixels, frame->lcd, frame->highlights);
+        return;
+    }
+    for (int y = 0; y < FL_LCD_HEIGHT; y++) {
+        const uint8_t* page = &frame->lcd[(y >> 3) * FL_LCD_WIDTH];
+        for (int x = 0; x < FL_LCD_WIDTH; x++) {
+            uint32_t color = (page[x] >> (y & 7)) & 1 ? ctx->lcd_fg : ctx->lcd_bg;
+            if (ctx->ui_rotate)
+                c->pixels[x * FL_LCD_HEIGHT + y] = color;
+            else
+                c->pixels[y * FL_LCD_WIDTH + x] = color;
+        }
+    }
+}
+
+// lcd captures use the two lcd colors, skin captures the 3-3-2 rgb palette
+static void palette_init(FLIPPER_CAPTURE* c) {
+    if (!c->skin) {
+        c->palette_bits = 1;
+        c->palette[0] = c->ctx->lcd_bg;
+        c->palette[1] = c->ctx->lcd_fg;
+        return;
+    }
+    c->palette_bits = 8;
+    for (int i = 0; i < 256; i++) {
+        uint32_t r = (i >> 5) * 255 / 7;
+        uint32_t g = ((i >> 2) & 7) * 255 / 7;
+        uint32_t b = (i & 3) * 255 / 3;
+        c->palette[i] = 0xff000000 | (r << 16) | (g << 8) | b;
+    }
+}
+
+static void palette_indices(FLIPPER_CAPTURE* c, const uint32_t* pixels) {
+    int n = c->width * c->height;
+    if (!c->skin) {
+        for (int i = 0; i < n; i++)
+            c->indices[i] = pixels[i] == c->ctx->lcd_fg;
+        return;
+    }
+    for (int i = 0; i < n; i++) {
+        uint32_t p = pixels[i];
+        c->indices[i] = (uint8_t)(((p >> 16) & 0xe0) | ((p >> 11) & 0x1c) | ((p >> 6) & 0x03));
+    }
+}
+
+// bounding box of the pixels that differ, empty if the frames are equal
+static SDL_Rect changed_rect(FLIPPER_CAPTURE* c, const uint32_t* a, const uint32_t* b) {
+    SDL_Rect r = { 0, 0, 0, 0 };
+    int left = c->width, right = -1, top = -1, bottom = -1;
+    for (int y = 0; y < c->height; y++) {
+        const uint32_t* ra = &a[y * c->width];
+        const uint32_t* rb = &b[y * c->width];
+        if (memcmp(ra, rb, c->width * sizeof(uint32_t)) == 0)
+            continue;
+        if (top < 0)
+            top = y;
+        bottom = y;
+        for (int x = 0; x < left; x++) {
+            if (ra[x] != rb[x]) {
+                left = x;
+                break;
+            }
+        }
+        for (int x = c->width - 1; x > right; x--) {
+            if (ra[x] != rb[x]) {
+                right = x;
+                break;
+            }
+        }
+    }
+    if (top >= 0) {
+        r.x = left;
+        r.y = top;
+        r.w = right - left + 1;
+        r.h = bottom - top + 1;
+    }
+    return r;
+}
+
+static int gif_delay(uint64_t start_us, uint64_t end_us) {
+    int delay = (int)(end_us / 10000 - start_us / 10000);
+    return delay < 1 ? 1 : delay;
+}
+
+// the png path is used as a printf format: exactly one %d with an optional width like %05d,
+// other % only as %%
+static bool frame_pattern_valid(const char* path) {
+    int conversions = 0;
+    for (const char* p = path; *p; p++) {
+        if (*p != '%')
+            continue;
+        if (p[1] == '%') {
+            p++;
+            continue;
+        }
+        p++;
+        while (*p >= '0' && *p <= '9')
+            p++;
+        if (*p != 'd')
+            return false;
+        conversions++;
+    }
+    return conversions == 1;
+}
+
+static void write_png(FLIPPER_CAPTURE* c, uint32_t frame) {
+    char name[1024];
+    snprintf(name, sizeof(name), c->path, (int)frame);
+    SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormatFrom(
+        c->pixels, c->width, c->height, 32, c->width * 4, SDL_PIXELFORMAT_ARGB8888);
+    if (!surface || IMG_SavePNG(surface, name) != 0)
+        printf("flipper_capture: can't write %s\n", name);
+    SDL_FreeSurface(surface);
+}
+
+static void gif_write_pending(FLIPPER_CAPTURE* c, uint64_t end_us) {
+    palette_indices(c, c->shown);
+    gif_image(c, &c->pending, gif_delay(c->pending_us, end_us));
+}
+
+static void encode_frame(FLIPPER_CAPTURE* c, const CAPTURE_FRAME* frame) {
+    frame_pixels(c, frame);
+
+    SDL_Rect r = { 0, 0, c->width, c->height };
+    if (c->have_frame) {
+        r = changed_rect(c, c->shown, c->pixels);
+        if (r.w == 0) {
+            // same as the frame before, which is now shown longer
+            c->end_us = frame->end_us;
+            return;
+        }
+        if (c->gif)
+            gif_write_pending(c, frame->start_us);
+    }
+    if (!c->gif)
+        write_png(c, frame->frame);
+
+    uint32_t* shown = c->shown;
+    c->shown = c->pixels;
+    c->pixels = shown;
+    c->have_frame = true;
+    c->pending = r;
+    c->pending_us = frame->start_us;
+    c->end_us = frame->end_us;
+}
+
+static int encoder_thread(void* data) {
+    FLIPPER_CAPTURE* c = (FLIPPER_CAPTURE*)data;
+    while (true) {
+        SDL_SemWait(c->filled);
+        CAPTURE_FRAME* frame = &c->queue[c->tail];
+        if (frame->end)
+            break;
+        encode_frame(c, frame);
+        c->tail = (c->tail + 1) % FLIPPER_CAPTURE_QUEUE_SIZE;
+        SDL_SemPost(c->free);
+    }
+
+    if (c->gif && c->file) {
+        if (c->have_frame)
+            gif_write_pending(c, c->end_us);
+        fputc(0x3b, c->file);  // trailer
+    }
+    return 0;
+}
+
+FLIPPER_CAPTURE* flipper_capture_create(FLIPPER_CTX* ctx, const char* path, int flags) {
+    FLIPPER_CAPTURE* c = (FLIPPER_CAPTURE*)SDL_calloc(1, sizeof(FLIPPER_CAPTURE));
+    if (!c) {
+        printf("flipper_capture: calloc\n");
+        return NULL;
+    }
+    c->ctx = ctx;
+    c->skin = (flags & FL_CAPTURE_SKIN) != 0;
+    if (c->skin && ctx->headless) {
+        printf("flipper_capture: no skin without a window, capturing the lcd\n");
+        c->skin = false;
+    }
+    if (c->skin) {
+        c->width = ctx->skin_width;
+        c->height = ctx->skin_height;
+    } else {
+        c->width = ctx->ui_rotate ? FL_LCD_HEIGHT : FL_LCD_WIDTH;
+        c->height = ctx->ui_rotate ? FL_LCD_WIDTH : FL_LCD_HEIGHT;
+    }
+
+    size_t len = strlen(path);
+    c->gif = len >= 4 && SDL_strcasecmp(path + len - 4, ".gif") == 0;
+    if (!c->gif && !frame_pattern_valid(path)) {
+        printf("flipper_capture: %s needs to end with .gif or contain one frame number format "
+               "like %%05d\n",
+               path);
+        SDL_free(c);
+        return NULL;
+    }
+
+    size_t n = (size_t)c->width * c->height;
+    c->path = SDL_strdup(path);
+    c->pixels = (uint32_t*)SDL_malloc(n * sizeof(uint32_t));
+    c->shown = (uint32_t*)SDL_malloc(n * sizeof(uint32_t));
+    c->indices = (uint8_t*)SDL_malloc(n);
+    c->free = SDL_CreateSemaphore(FLIPPER_CAPTURE_QUEUE_SIZE);
+    c->filled = SDL_CreateSemaphore(0);
+    if (!c->path || !c->pixels || !c->shown || !c->indices || !c->free || !c->filled) {
+        printf("flipper_capture: out of memory\n");
+        flipper_capture_destroy(c);
+        return NULL;
+    }
+
+    if (c->gif) {
+        c->file = fopen(path, "wb");
+        if (!c->file) {
+            printf("flipper_capture: can't create %s\n", path);
+            flipper_capture_destroy(c);
+            return NULL;
+        }
+        palette_init(c);
+        gif_start(c);
+    }
+
+    c->thread = SDL_CreateThread(encoder_thread, "flipper_capture", c);
+    if (!c->thread) {
+        printf("flipper_capture: SDL_CreateThread\n");
+        flipper_capture_destroy(c);
+        return NULL;
+    }
+    return c;
+}
+
+void flipper_capture_destroy(FLIPPER_CAPTURE* c) {
+    if (!c)
+        return;
+    if (c->thread) {
+        SDL_SemWait(c->free);
+        c->queue[c->head].end = true;
+        SDL_SemPost(c->filled);
+        SDL_WaitThread(c->thread, NULL);
+    }
+    if (c->file)
+        fclose(c->file);
+    if (c->free)
+        SDL_DestroySemaphore(c->free);
+    if (c->filled)
+        SDL_DestroySemaphore(c->filled);
+    SDL_free(c->indices);
+    SDL_free(c->shown);
+    SDL_free(c->pixels);
+    SDL_free(c->path);
+    SDL_free(c);
+}
+
+void flipper_capture_frame(FLIPPER_CAPTURE* c, uint32_t frame, int fps, const uint8_t* lcd,
+                           uint32_t highlights) {
+    // waits only if the encoder is a whole queue behind
+    SDL_SemWait(c->free);
+    CAPTURE_FRAME* f = &c->queue[c->head];
+    f->end = false;
+    f->frame = frame;
+    f->start_us = c->time_us;
+    c->time_us += 1000000 / fps;
+    f->end_us = c->time_us;
+    f->highlights = highlights;
+    memcpy(f->lcd, lcd, FL_LCD_BUFFER_SIZE);
+    c->head = (c->head + 1) % FLIPPER_CAPTURE_QUEUE_SIZE;
+    SDL_SemPost(c->filled);
+}
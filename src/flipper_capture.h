@@ -0,0 +1,27 @@
+#pragma once
+
+// Frame capture to an animated gif or a png sequence. flipper_lcd_update copies every frame
+// into a bounded queue and a background thread converts and encodes it, so the frame loop
+// only waits if the encoder falls FLIPPER_CAPTURE_QUEUE_SIZE frames behind.
+//
+// A frame equal to the previous one is merged into it: gif frames get a longer delay,
+// png files are only written for frames that changed, named after the frame they start at.
+// Gif frames after the first only contain the rectangle that changed.
+
+#include <SDL.h>
+
+#include "flipper.h"
+
+#define FLIPPER_CAPTURE_QUEUE_SIZE 64
+
+typedef struct FLIPPER_CAPTURE FLIPPER_CAPTURE;
+
+// ctx is only read for its skin and rotation, flags are FL_CAPTURE_*
+FLIPPER_CAPTURE* flipper_capture_create(FLIPPER_CTX* ctx, const char* path, int flags);
+// encodes the queued frames and finishes the file
+void flipper_capture_destroy(FLIPPER_CAPTURE* capture);
+
+// queue the lcd contents of frame number frame, shown for 1 / fps seconds. highlights has a
+// bit per lit button highlight, see flipper_ctx_lit_highlights
+void flipper_capture_frame(FLIPPER_CAPTURE* capture, uint32_t frame, int fps,
+                           const uint8_t* lcd, uint32_t highlights);
@@ -0,0 +1,113 @@
+#pragma once
+
+// Simulator state behind FLIPPER_CTX, shared by the simulator sources. Apps only see
+// the opaque type from flipper.h.
+
+#include <SDL.h>
+
+#include "flipper.h"
+#include "flipper_bench.h"
+#include "flipper_capture.h"
+#include "flipper_expand.h"
+#include "flipper_golden.h"
+#include "flipper_input.h"
+#include "flipper_shm.h"
+#include "flipper_stats.h"
+
+#define FL_LCD_BUFFER_SIZE (FL_LCD_PAGES * FL_LCD_WIDTH)
+
+// pcg32 random generator, see https://www.pcg-random.org
+typedef struct FLIPPER_RANDOM FLIPPER_RANDOM;
+struct FLIPPER_RANDOM {
+    uint64_t seed;
+    uint64_t state;
+};
+
+struct FLIPPER_CTX {
+    bool ui_rotate;
+    bool headless;
+
+    bool img_init;  // holds one of the SDL_image references counted in img_users
+    SDL_Window* window;
+    SDL_Renderer* renderer;
+    SDL_Texture* ui_skin;  // whole window, streaming texture written through SDL_LockTexture
+
+    // window contents are composed on the cpu straight into the locked skin texture:
+    // skin_base is the background, already rotated, highlights and the 2x lcd go on top of it
+    int skin_width;
+    int skin_height;
+    uint32_t* skin_base;
+    uint32_t* highlight_pixels;  // HIGHLIGHT_SIZE squared
+    SDL_Rect skin_lcd;           // lcd area in the window
+
+    uint8_t lcd_buffer[FL_LCD_BUFFER_SIZE];
+    uint32_t lcd_fg;  // ARGB colors of set and clear lcd pixels
+    uint32_t lcd_bg;
+    FLIPPER_EXPAND_FUNC lcd_expand;  // writes lcd_buffer 2x scaled into the skin
+
+    // what the window currently shows, frames without changes are not presented again
+    uint8_t lcd_presented[FL_LCD_BUFFER_SIZE];
+    uint32_t highlights_presented;  // bit per highlight button
+    bool redraw;                    // window or texture contents were lost, write everything
+
+    // gpio_state is the result of all changes so far, events holds the changes themselves
+    uint8_t gpio_state[FL_GPIO_COUNT];
+    int32_t key_time[FL_GPIO_COUNT];
+    FLIPPER_EVENT_QUEUE events;
+    bool events_enabled;      // FL_INIT_EVENTS
+    uint32_t events_dropped;  // changes lost because the app didn't keep up
+    uint64_t time_base;       // performance counter at init, for flipper_get_time_us
+
+    // virtual clock: time only advances by one frame per flipper_lcd_constant_fps call
+    bool virtual_clock;
+    int32_t virtual_base;  // tics when fps was last changed
+    uint32_t virtual_frames;
+
+    // frame pacing, frame n of the schedule is due at pace_start + n / fps
+    int fps;
+    int pace_policy;  // FL_PACE_*
+    uint64_t pace_start;
+    uint64_t pace_frame;
+    uint32_t late_frames;
+    uint32_t dropped_frames;
+
+    uint32_t frame_count;
+    uint32_t frame_limit;  // raise FL_GPIO_SIMULATOR_EXIT after this many frames, 0 = never
+    int exit_reason;       // FL_EXIT_*
+    int score;             // reported by the app for batch summaries
+
+    FLIPPER_RANDOM rng;
+
+    // input recording / replay, frames are counted in flipper_gpio_update calls
+    uint32_t input_frame;
+    FLIPPER_INPUT_LOG input_record;
+    FLIPPER_INPUT_LOG input_replay;
+    FLIPPER_INPUT_EVENT replay_next;
+    bool replay_pending;
+
+    FLIPPER_STATS stats;
+    FLIPPER_BENCH bench;  // see flipper_bench.h
+
+    // frame hashes, see flipper_golden.h
+    FLIPPER_GOLDEN hash_record;
+    FLIPPER_GOLDEN hash_check;
+    char* hash_check_path;  // diverging frames are dumped next to it
+    bool golden_failed;
+
+    FLIPPER_CAPTURE* capture;  // see flipper_capture.h, NULL if not capturing
+    FLIPPER_SHM* shm;          // see flipper_shm.h, NULL if frames are not exported
+};
+
+// instance used by the functions without context in the calling thread
+FLIPPER_CTX* flipper_ctx_get_current();
+
+// bit per button highlight that is lit this frame
+uint32_t flipper_ctx_lit_highlights(FLIPPER_CTX* ctx);
+
+// the window contents for lcd and highlights, skin_width x skin_height pixels. Only reads
+// state set up by init, so it may be called from any thread while ctx is alive.
+void flipper_ctx_skin_compose(const FLIPPER_CTX* ctx, uint32_t* dst, const uint8_t* lcd,
+                              uint32_t highlights);
+
+// decodes the font, called for every new instance
+void flipper_text_init();
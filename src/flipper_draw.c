@@ -0,0 +1,135 @@
+// Drawing primitives working on whole lcd bytes: everything is clipped once, then each
+// affected page byte is combined with a mask of all its covered rows.
+
+#include <string.h>
+
+#include "flipper.h"
+#include "flipper_ctx.h"
+
+// combine one lcd byte with src, only the rows in mask are touched
+static inline void combine(uint8_t* dst, uint8_t src, uint8_t mask, int mode) {
+    switch (mode) {
+        case FL_DRAW_OR: *dst |= src & mask; break;
+        case FL_DRAW_AND: *dst &= src | ~mask; break;
+        case FL_DRAW_XOR: *dst ^= src & mask; break;
+        case FL_DRAW_CLEAR: *dst &= ~(src & mask); break;
+    }
+}
+
+// rows top..bottom-1 of page
+static inline uint8_t page_mask(int page, int top, int bottom) {
+    int first = top - page * 8;
+    int last = bottom - page * 8;
+    uint8_t mask = 0xff;
+    if (first > 0)
+        mask &= 0xff << first;
+    if (last < 8)
+        mask &= 0xff >> (8 - last);
+    return mask;
+}
+
+// a solid rectangle, all primitives except the blit end up here
+static void fill(FLIPPER_CTX* ctx, int x, int y, int width, int height, int mode) {
+    int left = x < 0 ? 0 : x;
+    int right = x + width > FL_LCD_WIDTH ? FL_LCD_WIDTH : x + width;
+    int top = y < 0 ? 0 : y;
+    int bottom = y + height > FL_LCD_HEIGHT ? FL_LCD_HEIGHT : y + height;
+    // and with a solid source changes nothing
+    if (left >= right || top >= bottom || mode == FL_DRAW_AND)
+        return;
+
+    for (int page = top >> 3; page <= (bottom - 1) >> 3; page++) {
+        uint8_t mask = page_mask(page, top, bottom);
+        uint8_t* dst = &ctx->lcd_buffer[page * FL_LCD_WIDTH];
+
+        // whole bytes
+        if (mask == 0xff && mode != FL_DRAW_XOR) {
+            memset(&dst[left], mode == FL_DRAW_OR ? 0xff : 0, right - left);
+            continue;
+        }
+        for (int i = left; i < right; i++) {
+            combine(&dst[i], 0xff, mask, mode);
+        }
+    }
+}
+
+void flipper_ctx_draw_hline(FLIPPER_CTX* ctx, int x, int y, int width, int mode) {
+    fill(ctx, x, y, width, 1, mode);
+}
+
+void flipper_ctx_draw_vline(FLIPPER_CTX* ctx, int x, int y, int height, int mode) {
+    fill(ctx, x, y, 1, height, mode);
+}
+
+void flipper_ctx_draw_fill_rect(FLIPPER_CTX* ctx, int x, int y, int width, int height,
+                                int mode) {
+    fill(ctx, x, y, width, height, mode);
+}
+
+// the sides leave out the corners, so XOR doesn't invert them twice
+void flipper_ctx_draw_rect(FLIPPER_CTX* ctx, int x, int y, int width, int height, int mode) {
+    if (width <= 0 || height <= 0)
+        return;
+
+    fill(ctx, x, y, width, 1, mode);
+    if (height > 1)
+        fill(ctx, x, y + height - 1, width, 1, mode);
+    if (height > 2) {
+        fill(ctx, x, y + 1, 1, height - 2, mode);
+        if (width > 1)
+            fill(ctx, x + width - 1, y + 1, 1, height - 2, mode);
+    }
+}
+
+void flipper_ctx_draw_blit(FLIPPER_CTX* ctx, int x, int y, const FLIPPER_SPRITE* sprite,
+                           int mode) {
+    int left = x < 0 ? 0 : x;
+    int right = x + sprite->width > FL_LCD_WIDTH ? FL_LCD_WIDTH : x + sprite->width;
+    if (left >= right || y >= FL_LCD_HEIGHT || y + sprite->height <= 0)
+        return;
+
+    // sprite page p lands on lcd pages first + p and first + p + 1, shifted down by shift
+    int first = y >> 3;  // arithmetic shift, rounds down for negative y
+    int shift = y & 7;
+    int pages = (sprite->height + 7) >> 3;
+
+    for (int p = 0; p < pages; p++) {
+        int rows = sprite->height - p * 8;
+        uint16_t mask = (uint16_t)((rows >= 8 ? 0xff : (1 << rows) - 1) << shift);
+        const uint8_t* src = &sprite->data[p * sprite->width + left - x];
+
+        for (int half = 0; half < 2; half++) {
+            int page = first + p + half;
+            uint8_t m = (uint8_t)(mask >> (half * 8));
+            if (page < 0 || page >= FL_LCD_PAGES || !m)
+                continue;
+
+            uint8_t* dst = &ctx->lcd_buffer[page * FL_LCD_WIDTH];
+            int s = shift - half * 8;
+            for (int i = left; i < right; i++) {
+                uint16_t v = s >= 0 ? (uint16_t)(src[i - left] << s) : src[i - left] >> -s;
+                combine(&dst[i], (uint8_t)v, m, mode);
+            }
+        }
+    }
+}
+
+void flipper_draw_hline(int x, int y, int width, int mode) {
+    flipper_ctx_draw_hline(flipper_ctx_get_current(), x, y, width, mode);
+}
+
+void flipper_draw_vline(int x, int y, int height, int mode) {
+    flipper_ctx_draw_vline(flipper_ctx_get_current(), x, y, height, mode);
+}
+
+void flipper_draw_fill_rect(int x, int y, int width, int height, int mode) {
+    flipper_ctx_draw_fill_rect(flipper_ctx_get_current(), x, y, width, height, mode);
+}
+
+void flipper_draw_rect(int x, int y, int width, int height, int mode) {
+    flipper_ctx_draw_rect(flipper_ctx_get_current(), x, y, width, height, mode);
+}
+
+void flipper_draw_blit(int x, int y, const FLIPPER_SPRITE* sprite, int mode) {
+    flipper_ctx_draw_blit(flipper_ctx_get_current(), x, y, sprite, mode);
+}
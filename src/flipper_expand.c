@@ -0,0 +1,236 @@
+#include "flipper_expand.h"
+
+#include <SDL.h>
+#include <string.h>
+
+#include "flipper.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define EXPAND_X86
+#include <immintrin.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_AVX2
+#endif
+
+static void expand_scalar(uint32_t* dst, int dst_pitch, const uint8_t* lcd, int pages,
+                          uint32_t fg, uint32_t bg) {
+    for (int y = 0; y < pages * 8; y++) {
+        const uint8_t* page = &lcd[(y >> 3) * FL_LCD_WIDTH];
+        uint8_t mask = 1 << (y & 7);
+        for (int x = 0; x < FL_LCD_WIDTH; x++) {
+            dst[x] = (page[x] & mask) ? fg : bg;
+        }
+        dst += dst_pitch;
+    }
+}
+
+static void expand_scalar_2x(uint32_t* dst, int dst_pitch, const uint8_t* lcd, int pages,
+                             uint32_t fg, uint32_t bg) {
+    for (int y = 0; y < pages * 8; y++) {
+        const uint8_t* page = &lcd[(y >> 3) * FL_LCD_WIDTH];
+        uint8_t mask = 1 << (y & 7);
+        for (int x = 0; x < FL_LCD_WIDTH; x++) {
+            uint32_t c = (page[x] & mask) ? fg : bg;
+            dst[2 * x] = c;
+            dst[2 * x + 1] = c;
+        }
+        memcpy(dst + dst_pitch, dst, FL_LCD_WIDTH * 2 * sizeof(uint32_t));
+        dst += 2 * dst_pitch;
+    }
+}
+
+static void expand_scalar_2x_rotated(uint32_t* dst, int dst_pitch, const uint8_t* lcd, int pages,
+                                     uint32_t fg, uint32_t bg) {
+    for (int x = 0; x < FL_LCD_WIDTH; x++) {
+        for (int p = 0; p < pages; p++) {
+            uint8_t b = lcd[p * FL_LCD_WIDTH + x];
+            uint32_t* out = &dst[p * 16];
+            for (int i = 0; i < 8; i++) {
+                uint32_t c = (b & (1 << i)) ? fg : bg;
+                out[2 * i] = c;
+                out[2 * i + 1] = c;
+            }
+        }
+        memcpy(dst + dst_pitch, dst, pages * 16 * sizeof(uint32_t));
+        dst += 2 * dst_pitch;
+    }
+}
+
+#ifdef EXPAND_X86
+
+// 16 pixels of one row: compare the row bit of 16 page bytes and widen the
+// resulting byte masks to 32 bit color selects
+static void expand_sse2(uint32_t* dst, int dst_pitch, const uint8_t* lcd, int pages, uint32_t fg,
+                        uint32_t bg) {
+    __m128i vbg = _mm_set1_epi32((int)bg);
+    __m128i vdiff = _mm_set1_epi32((int)(fg ^ bg));
+
+    for (int y = 0; y < pages * 8; y++) {
+        const uint8_t* page = &lcd[(y >> 3) * FL_LCD_WIDTH];
+        __m128i vbit = _mm_set1_epi8((char)(1 << (y & 7)));
+
+        for (int x = 0; x < FL_LCD_WIDTH; x += 16) {
+            __m128i v = _mm_loadu_si128((const __m128i*)&page[x]);
+            __m128i m8 = _mm_cmpeq_epi8(_mm_and_si128(v, vbit), vbit);
+            __m128i m16lo = _mm_unpacklo_epi8(m8, m8);
+            __m128i m16hi = _mm_unpackhi_epi8(m8, m8);
+
+            __m128i* out = (__m128i*)&dst[x];
+            __m128i m;
+            m = _mm_unpacklo_epi16(m16lo, m16lo);
+            _mm_storeu_si128(out + 0, _mm_xor_si128(vbg, _mm_and_si128(vdiff, m)));
+            m = _mm_unpackhi_epi16(m16lo, m16lo);
+            _mm_storeu_si128(out + 1, _mm_xor_si128(vbg, _mm_and_si128(vdiff, m)));
+            m = _mm_unpacklo_epi16(m16hi, m16hi);
+            _mm_storeu_si128(out + 2, _mm_xor_si128(vbg, _mm_and_si128(vdiff, m)));
+            m = _mm_unpackhi_epi16(m16hi, m16hi);
+            _mm_storeu_si128(out + 3, _mm_xor_si128(vbg, _mm_and_si128(vdiff, m)));
+        }
+        dst += dst_pitch;
+    }
+}
+
+// store 4 colors doubled horizontally to two rows
+static inline void store_2x_sse2(uint32_t* row0, uint32_t* row1, __m128i c) {
+    __m128i lo = _mm_unpacklo_epi32(c, c);
+    __m128i hi = _mm_unpackhi_epi32(c, c);
+    _mm_storeu_si128((__m128i*)row0, lo);
+    _mm_storeu_si128((__m128i*)(row0 + 4), hi);
+    _mm_storeu_si128((__m128i*)row1, lo);
+    _mm_storeu_si128((__m128i*)(row1 + 4), hi);
+}
+
+static void expand_sse2_2x(uint32_t* dst, int dst_pitch, const uint8_t* lcd, int pages,
+                           uint32_t fg, uint32_t bg) {
+    __m128i vbg = _mm_set1_epi32((int)bg);
+    __m128i vdiff = _mm_set1_epi32((int)(fg ^ bg));
+
+    for (int y = 0; y < pages * 8; y++) {
+        const uint8_t* page = &lcd[(y >> 3) * FL_LCD_WIDTH];
+        __m128i vbit = _mm_set1_epi8((char)(1 << (y & 7)));
+        uint32_t* next = dst + dst_pitch;
+
+        for (int x = 0; x < FL_LCD_WIDTH; x += 16) {
+            __m128i v = _mm_loadu_si128((const __m128i*)&page[x]);
+            __m128i m8 = _mm_cmpeq_epi8(_mm_and_si128(v, vbit), vbit);
+            __m128i m16lo = _mm_unpacklo_epi8(m8, m8);
+            __m128i m16hi = _mm_unpackhi_epi8(m8, m8);
+
+            __m128i m;
+            m = _mm_unpacklo_epi16(m16lo, m16lo);
+            store_2x_sse2(&dst[2 * x], &next[2 * x], _mm_xor_si128(vbg, _mm_and_si128(vdiff, m)));
+            m = _mm_unpackhi_epi16(m16lo, m16lo);
+            store_2x_sse2(&dst[2 * x + 8], &next[2 * x + 8],
+                          _mm_xor_si128(vbg, _mm_and_si128(vdiff, m)));
+            m = _mm_unpacklo_epi16(m16hi, m16hi);
+            store_2x_sse2(&dst[2 * x + 16], &next[2 * x + 16],
+                          _mm_xor_si128(vbg, _mm_and_si128(vdiff, m)));
+            m = _mm_unpackhi_epi16(m16hi, m16hi);
+            store_2x_sse2(&dst[2 * x + 24], &next[2 * x + 24],
+                          _mm_xor_si128(vbg, _mm_and_si128(vdiff, m)));
+        }
+        dst += 2 * dst_pitch;
+    }
+}
+
+// one page byte becomes 16 pixels of a row: broadcast it and test one bit per lane
+static void expand_sse2_2x_rotated(uint32_t* dst, int dst_pitch, const uint8_t* lcd, int pages,
+                                   uint32_t fg, uint32_t bg) {
+    __m128i vbg = _mm_set1_epi32((int)bg);
+    __m128i vdiff = _mm_set1_epi32((int)(fg ^ bg));
+    __m128i bits0 = _mm_set_epi32(8, 4, 2, 1);
+    __m128i bits1 = _mm_set_epi32(128, 64, 32, 16);
+
+    for (int x = 0; x < FL_LCD_WIDTH; x++) {
+        uint32_t* next = dst + dst_pitch;
+        for (int p = 0; p < pages; p++) {
+            __m128i v = _mm_set1_epi32(lcd[p * FL_LCD_WIDTH + x]);
+            __m128i m0 = _mm_cmpeq_epi32(_mm_and_si128(v, bits0), bits0);
+            __m128i m1 = _mm_cmpeq_epi32(_mm_and_si128(v, bits1), bits1);
+            store_2x_sse2(&dst[p * 16], &next[p * 16],
+                          _mm_xor_si128(vbg, _mm_and_si128(vdiff, m0)));
+            store_2x_sse2(&dst[p * 16 + 8], &next[p * 16 + 8],
+                          _mm_xor_si128(vbg, _mm_and_si128(vdiff, m1)));
+        }
+        dst += 2 * dst_pitch;
+    }
+}
+
+// same as sse2, but widens 8 masks at once with a sign extending move
+TARGET_AVX2 static void expand_avx2(uint32_t* dst, int dst_pitch, const uint8_t* lcd,
+                                    int pages, uint32_t fg, uint32_t bg) {
+    __m256i vbg = _mm256_set1_epi32((int)bg);
+    __m256i vdiff = _mm256_set1_epi32((int)(fg ^ bg));
+
+    for (int y = 0; y < pages * 8; y++) {
+        const uint8_t* page = &lcd[(y >> 3) * FL_LCD_WIDTH];
+        __m128i vbit = _mm_set1_epi8((char)(1 << (y & 7)));
+
+        for (int x = 0; x < FL_LCD_WIDTH; x += 16) {
+            __m128i v = _mm_loadu_si128((const __m128i*)&page[x]);
+            __m128i m8 = _mm_cmpeq_epi8(_mm_and_si128(v, vbit), vbit);
+            __m256i m32lo = _mm256_cvtepi8_epi32(m8);
+            __m256i m32hi = _mm256_cvtepi8_epi32(_mm_srli_si128(m8, 8));
+
+            __m256i* out = (__m256i*)&dst[x];
+            _mm256_storeu_si256(out + 0, _mm256_xor_si256(vbg, _mm256_and_si256(vdiff, m32lo)));
+            _mm256_storeu_si256(out + 1, _mm256_xor_si256(vbg, _mm256_and_si256(vdiff, m32hi)));
+        }
+        dst += dst_pitch;
+    }
+}
+
+#endif
+
+// the 2x layouts are bound by stores, avx2 uses the sse2 versions for them
+static const FLIPPER_EXPAND_FUNC kernels[FLIPPER_EXPAND_COUNT][FLIPPER_EXPAND_LAYOUT_COUNT] = {
+    { expand_scalar, expand_scalar_2x, expand_scalar_2x_rotated },
+#ifdef EXPAND_X86
+    { expand_sse2, expand_sse2_2x, expand_sse2_2x_rotated },
+    { expand_avx2, expand_sse2_2x, expand_sse2_2x_rotated },
+#endif
+};
+
+FLIPPER_EXPAND_FUNC flipper_expand_kernel(int kernel, int layout) {
+    if (layout < 0 || layout >= FLIPPER_EXPAND_LAYOUT_COUNT)
+        return NULL;
+    switch (kernel) {
+        case FLIPPER_EXPAND_SCALAR: return kernels[kernel][layout];
+#ifdef EXPAND_X86
+        case FLIPPER_EXPAND_SSE2: return SDL_HasSSE2() ? kernels[kernel][layout] : NULL;
+        case FLIPPER_EXPAND_AVX2: return SDL_HasAVX2() ? kernels[kernel][layout] : NULL;
+#endif
+    }
+    return NULL;
+}
+
+const char* flipper_expand_name(int kernel) {
+    switch (kernel) {
+        case FLIPPER_EXPAND_SCALAR: return "scalar";
+        case FLIPPER_EXPAND_SSE2: return "sse2";
+        case FLIPPER_EXPAND_AVX2: return "avx2";
+    }
+    return "unknown";
+}
+
+const char* flipper_expand_layout_name(int layout) {
+    switch (layout) {
+        case FLIPPER_EXPAND_1X: return "1x";
+        case FLIPPER_EXPAND_2X: return "2x";
+        case FLIPPER_EXPAND_2X_ROTATED: return "2x_rotated";
+    }
+    return "unknown";
+}
+
+FLIPPER_EXPAND_FUNC flipper_expand_best(int layout) {
+    for (int k = FLIPPER_EXPAND_COUNT - 1; k > 0; k--) {
+        FLIPPER_EXPAND_FUNC f = flipper_expand_kernel(k, layout);
+        if (f)
+            return f;
+    }
+    return flipper_expand_kernel(FLIPPER_EXPAND_SCALAR, layout);
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stdint.h>
+
+// convert packed lcd pages (see FL_LCD_PAGES) into one 32 bit color per pixel, lcd points
+// to the first page to convert and dst to its first row, dst_pitch is the distance between
+// two rows of dst in pixels
+typedef void (*FLIPPER_EXPAND_FUNC)(uint32_t* dst, int dst_pitch, const uint8_t* lcd, int pages,
+                                    uint32_t fg, uint32_t bg);
+
+enum {
+    FLIPPER_EXPAND_SCALAR = 0,
+    FLIPPER_EXPAND_SSE2,
+    FLIPPER_EXPAND_AVX2,
+    FLIPPER_EXPAND_COUNT,
+};
+
+// how lcd pixels are laid out in dst
+enum {
+    FLIPPER_EXPAND_1X = 0,      // one pixel per lcd pixel
+    FLIPPER_EXPAND_2X,          // 2x2 pixels per lcd pixel
+    FLIPPER_EXPAND_2X_ROTATED,  // 2x2 pixels, transposed: lcd column x fills dst rows 2x, 2x+1
+                                // and page p starts at dst column 16p
+    FLIPPER_EXPAND_LAYOUT_COUNT,
+};
+
+// returns NULL if the kernel is not compiled in or not supported by the cpu
+FLIPPER_EXPAND_FUNC flipper_expand_kernel(int kernel, int layout);
+const char* flipper_expand_name(int kernel);
+const char* flipper_expand_layout_name(int layout);
+
+// fastest kernel for this cpu
+FLIPPER_EXPAND_FUNC flipper_expand_best(int layout);
@@ -0,0 +1,147 @@
+#include "flipper_golden.h"
+
+#include <string.h>
+
+static const char golden_magic[4] = { 'F', 'L', 'H', 'S' };
+
+#define PRIME64_1 0x9E3779B185EBCA87ULL
+#define PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define PRIME64_3 0x165667B19E3779F9ULL
+#define PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define PRIME64_5 0x27D4EB2F165667C5ULL
+
+static uint64_t rotl64(uint64_t v, int r) {
+    return (v << r) | (v >> (64 - r));
+}
+
+static uint32_t read32(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint64_t read64(const uint8_t* p) {
+    return read32(p) | ((uint64_t)read32(p + 4) << 32);
+}
+
+static uint64_t hash_round(uint64_t acc, uint64_t input) {
+    acc += input * PRIME64_2;
+    acc = rotl64(acc, 31);
+    return acc * PRIME64_1;
+}
+
+static uint64_t hash_merge(uint64_t acc, uint64_t v) {
+    acc ^= hash_round(0, v);
+    return acc * PRIME64_1 + PRIME64_4;
+}
+
+uint64_t flipper_hash64(const void* data, size_t len, uint64_t seed) {
+    const uint8_t* p = (const uint8_t*)data;
+    const uint8_t* end = p + len;
+    uint64_t h;
+
+    if (len >= 32) {
+        uint64_t v1 = seed + PRIME64_1 + PRIME64_2;
+        uint64_t v2 = seed + PRIME64_2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - PRIME64_1;
+        for (; p + 32 <= end; p += 32) {
+            v1 = hash_round(v1, read64(p));
+            v2 = hash_round(v2, read64(p + 8));
+            v3 = hash_round(v3, read64(p + 16));
+            v4 = hash_round(v4, read64(p + 24));
+        }
+        h = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+        h = hash_merge(h, v1);
+        h = hash_merge(h, v2);
+        h = hash_merge(h, v3);
+        h = hash_merge(h, v4);
+    } else {
+        h = seed + PRIME64_5;
+    }
+    h += len;
+
+    for (; p + 8 <= end; p += 8) {
+        h ^= hash_round(0, read64(p));
+        h = rotl64(h, 27) * PRIME64_1 + PRIME64_4;
+    }
+    if (p + 4 <= end) {
+        h ^= read32(p) * PRIME64_1;
+        h = rotl64(h, 23) * PRIME64_2 + PRIME64_3;
+        p += 4;
+    }
+    for (; p < end; p++) {
+        h ^= *p * PRIME64_5;
+        h = rotl64(h, 11) * PRIME64_1;
+    }
+
+    h ^= h >> 33;
+    h *= PRIME64_2;
+    h ^= h >> 29;
+    h *= PRIME64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+static void put_u64(uint8_t* p, uint64_t v) {
+    for (int i = 0; i < 8; i++)
+        p[i] = (uint8_t)(v >> (i * 8));
+}
+
+bool flipper_golden_create(FLIPPER_GOLDEN* golden, const char* path, uint64_t seed) {
+    golden->frame = 0;
+    golden->file = fopen(path, "wb");
+    if (!golden->file) {
+        printf("flipper_golden_create: can't create %s\n", path);
+        return false;
+    }
+
+    uint8_t header[16] = { 0 };
+    memcpy(header, golden_magic, 4);
+    header[4] = FLIPPER_GOLDEN_VERSION & 0xff;
+    header[5] = FLIPPER_GOLDEN_VERSION >> 8;
+    put_u64(header + 8, seed);
+    fwrite(header, sizeof(header), 1, golden->file);
+    return true;
+}
+
+bool flipper_golden_open(FLIPPER_GOLDEN* golden, const char* path, uint64_t* seed) {
+    golden->frame = 0;
+    golden->file = fopen(path, "rb");
+    if (!golden->file) {
+        printf("flipper_golden_open: can't open %s\n", path);
+        return false;
+    }
+
+    uint8_t header[16];
+    if (fread(header, sizeof(header), 1, golden->file) != 1 ||
+        memcmp(header, golden_magic, 4) != 0 ||
+        (header[4] | (header[5] << 8)) != FLIPPER_GOLDEN_VERSION) {
+        printf("flipper_golden_open: %s is not a frame hash stream\n", path);
+        flipper_golden_close(golden);
+        return false;
+    }
+
+    *seed = read64(header + 8);
+    return true;
+}
+
+void flipper_golden_close(FLIPPER_GOLDEN* golden) {
+    if (golden->file)
+        fclose(golden->file);
+    golden->file = NULL;
+}
+
+void flipper_golden_write(FLIPPER_GOLDEN* golden, uint64_t hash) {
+    uint8_t record[8];
+    put_u64(record, hash);
+    fwrite(record, sizeof(record), 1, golden->file);
+    golden->frame++;
+}
+
+bool flipper_golden_read(FLIPPER_GOLDEN* golden, uint64_t* hash) {
+    uint8_t record[8];
+    if (fread(record, sizeof(record), 1, golden->file) != 1)
+        return false;
+    *hash = read64(record);
+    golden->frame++;
+    return true;
+}
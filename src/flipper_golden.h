@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Frame hash stream for golden-frame regression runs: a header followed by one hash per
+// flipper_lcd_update
+//
+//   header: "FLHS" | u16 version | u16 reserved | u64 random seed
+//   record: u64 XXH64 (seed 0) of the packed lcd pages
+//
+// all values are little endian.
+
+#define FLIPPER_GOLDEN_VERSION 1
+
+// XXH64, see https://github.com/Cyan4973/xxHash/blob/dev/doc/xxhash_spec.md
+uint64_t flipper_hash64(const void* data, size_t len, uint64_t seed);
+
+typedef struct FLIPPER_GOLDEN FLIPPER_GOLDEN;
+struct FLIPPER_GOLDEN {
+    FILE* file;
+    uint32_t frame;  // records written or read so far
+};
+
+bool flipper_golden_create(FLIPPER_GOLDEN* golden, const char* path, uint64_t seed);
+bool flipper_golden_open(FLIPPER_GOLDEN* golden, const char* path, uint64_t* seed);
+void flipper_golden_close(FLIPPER_GOLDEN* golden);
+
+void flipper_golden_write(FLIPPER_GOLDEN* golden, uint64_t hash);
+// returns false at the end of the stream
+bool flipper_golden_read(FLIPPER_GOLDEN* golden, uint64_t* hash);
@@ -0,0 +1,150 @@
+#include "flipper_input.h"
+
+#include <string.h>
+
+#include "flipper.h"
+
+static const char input_magic[4] = { 'F', 'L', 'I', 'N' };
+
+static void put_u16(uint8_t* p, uint16_t v) {
+    p[0] = v & 0xff;
+    p[1] = v >> 8;
+}
+
+static void put_u32(uint8_t* p, uint32_t v) {
+    put_u16(p, v & 0xffff);
+    put_u16(p + 2, v >> 16);
+}
+
+static void put_u64(uint8_t* p, uint64_t v) {
+    put_u32(p, v & 0xffffffff);
+    put_u32(p + 4, v >> 32);
+}
+
+static uint16_t get_u16(const uint8_t* p) {
+    return p[0] | (p[1] << 8);
+}
+
+static uint32_t get_u32(const uint8_t* p) {
+    return get_u16(p) | ((uint32_t)get_u16(p + 2) << 16);
+}
+
+static uint64_t get_u64(const uint8_t* p) {
+    return get_u32(p) | ((uint64_t)get_u32(p + 4) << 32);
+}
+
+bool flipper_input_log_create(FLIPPER_INPUT_LOG* log, const char* path, uint64_t seed) {
+    log->frame = 0;
+    log->file = fopen(path, "wb");
+    if (!log->file) {
+        printf("flipper_input_log_create: can't create %s\n", path);
+        return false;
+    }
+
+    uint8_t header[16] = { 0 };
+    memcpy(header, input_magic, 4);
+    put_u16(header + 4, FLIPPER_INPUT_VERSION);
+    put_u64(header + 8, seed);
+    fwrite(header, sizeof(header), 1, log->file);
+    return true;
+}
+
+bool flipper_input_log_open(FLIPPER_INPUT_LOG* log, const char* path, uint64_t* seed) {
+    log->frame = 0;
+    log->file = fopen(path, "rb");
+    if (!log->file) {
+        printf("flipper_input_log_open: can't open %s\n", path);
+        return false;
+    }
+
+    uint8_t header[16];
+    if (fread(header, sizeof(header), 1, log->file) != 1 || memcmp(header, input_magic, 4) != 0 ||
+        get_u16(header + 4) != FLIPPER_INPUT_VERSION) {
+        printf("flipper_input_log_open: %s is not an input log\n", path);
+        flipper_input_log_close(log);
+        return false;
+    }
+
+    *seed = get_u64(header + 8);
+    return true;
+}
+
+void flipper_input_log_close(FLIPPER_INPUT_LOG* log) {
+    if (log->file)
+        fclose(log->file);
+    log->file = NULL;
+}
+
+void flipper_input_log_write(FLIPPER_INPUT_LOG* log, const FLIPPER_INPUT_EVENT* ev) {
+    uint8_t record[6];
+    int len = 0;
+
+    uint32_t delta = ev->frame - log->frame;
+    do {
+        record[len] = delta & 0x7f;
+        delta >>= 7;
+        if (delta)
+            record[len] |= 0x80;
+        len++;
+    } while (delta);
+    record[len++] = (ev->pin << 1) | (ev->state ? 1 : 0);
+
+    fwrite(record, len, 1, log->file);
+    log->frame = ev->frame;
+}
+
+bool flipper_input_log_read(FLIPPER_INPUT_LOG* log, FLIPPER_INPUT_EVENT* ev) {
+    uint32_t delta = 0;
+    int c;
+    for (int shift = 0; shift < 32; shift += 7) {
+        c = fgetc(log->file);
+        if (c == EOF)
+            return false;
+        delta |= (uint32_t)(c & 0x7f) << shift;
+        if (!(c & 0x80))
+            break;
+    }
+
+    c = fgetc(log->file);
+    if (c == EOF || (c >> 1) >= FL_GPIO_COUNT)
+        return false;
+
+    log->frame += delta;
+    ev->frame = log->frame;
+    ev->pin = c >> 1;
+    ev->state = c & 1;
+    return true;
+}
+
+void flipper_event_queue_init(FLIPPER_EVENT_QUEUE* queue) {
+    SDL_AtomicSet(&queue->head, 0);
+    SDL_AtomicSet(&queue->tail, 0);
+}
+
+// SDL_AtomicSet is only an acquire barrier with gcc and clang, the release barriers write the
+// event before head moves past it and read it before tail releases its slot
+bool flipper_event_queue_push(FLIPPER_EVENT_QUEUE* queue, const FLIPPER_EVENT* event) {
+    uint32_t head = (uint32_t)SDL_AtomicGet(&queue->head);
+    uint32_t tail = (uint32_t)SDL_AtomicGet(&queue->tail);
+    if (head - tail == FLIPPER_EVENT_QUEUE_SIZE)
+        return false;
+    SDL_MemoryBarrierAcquire();
+
+    queue->events[head & (FLIPPER_EVENT_QUEUE_SIZE - 1)] = *event;
+    SDL_MemoryBarrierRelease();
+    SDL_AtomicSet(&queue->head, (int)(head + 1));
+    return true;
+}
+
+bool flipper_event_queue_pop(FLIPPER_EVENT_QUEUE* queue, FLIPPER_EVENT* event) {
+    uint32_t tail = (uint32_t)SDL_AtomicGet(&queue->tail);
+    uint32_t head = (uint32_t)SDL_AtomicGet(&queue->head);
+    if (tail == head)
+        return false;
+    SDL_MemoryBarrierAcquire();
+
+    *event = queue->events[tail & (FLIPPER_EVENT_QUEUE_SIZE - 1)];
+    SDL_MemoryBarrierRelease();
+    SDL_AtomicSet(&queue->tail, (int)(tail + 1));
+    return true;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <SDL.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "flipper.h"
+
+// Input log: a header followed by one record per gpio change
+//
+//   header: "FLIN" | u16 version | u16 reserved | u64 random seed
+//   record: varint frame delta to previous record | u8 (pin << 1) | state
+//
+// all values are little endian, the frame counts flipper_gpio_update calls.
+
+#define FLIPPER_INPUT_VERSION 1
+
+typedef struct FLIPPER_INPUT_EVENT FLIPPER_INPUT_EVENT;
+struct FLIPPER_INPUT_EVENT {
+    uint32_t frame;
+    uint8_t pin;
+    uint8_t state;
+};
+
+typedef struct FLIPPER_INPUT_LOG FLIPPER_INPUT_LOG;
+struct FLIPPER_INPUT_LOG {
+    FILE* file;
+    uint32_t frame;  // frame of the last record
+};
+
+bool flipper_input_log_create(FLIPPER_INPUT_LOG* log, const char* path, uint64_t seed);
+bool flipper_input_log_open(FLIPPER_INPUT_LOG* log, const char* path, uint64_t* seed);
+void flipper_input_log_close(FLIPPER_INPUT_LOG* log);
+
+void flipper_input_log_write(FLIPPER_INPUT_LOG* log, const FLIPPER_INPUT_EVENT* ev);
+// returns false at the end of the log
+bool flipper_input_log_read(FLIPPER_INPUT_LOG* log, FLIPPER_INPUT_EVENT* ev);
+
+// Lock-free single producer / single consumer queue of gpio changes. The producer (the
+// simulator filling it from SDL or a replay) and the consumer (flipper_event_get) may run
+// on different threads, each index is only written by one side.
+
+#define FLIPPER_EVENT_QUEUE_SIZE 256  // power of two
+
+typedef struct FLIPPER_EVENT_QUEUE FLIPPER_EVENT_QUEUE;
+struct FLIPPER_EVENT_QUEUE {
+    SDL_atomic_t head;  // next slot to write, producer only
+    SDL_atomic_t tail;  // next slot to read, consumer only
+    FLIPPER_EVENT events[FLIPPER_EVENT_QUEUE_SIZE];
+};
+
+void flipper_event_queue_init(FLIPPER_EVENT_QUEUE* queue);
+// returns false if the queue is full
+bool flipper_event_queue_push(FLIPPER_EVENT_QUEUE* queue, const FLIPPER_EVENT* event);
+// returns false if the queue is empty
+bool flipper_event_queue_pop(FLIPPER_EVENT_QUEUE* queue, FLIPPER_EVENT* event);
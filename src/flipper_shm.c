@@ -0,0 +1,207 @@
+#include "flipper_shm.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// a reader gives up after this many torn reads of a slot
+#define READ_ATTEMPTS 16
+
+struct FLIPPER_SHM {
+    FLIPPER_SHM_HEADER* header;
+    char* name;
+#ifdef _WIN32
+    HANDLE mapping;
+#endif
+    uint32_t seq[FLIPPER_SHM_SLOTS];  // only this process writes, no need to load it back
+    uint32_t input_head;              // last head seen, so an empty mailbox costs one load
+    uint32_t input_tail;
+};
+
+#ifdef _WIN32
+
+// mappings go away with the last handle, an existing one always belongs to a live process,
+// so replace makes no difference
+static void* shm_map(FLIPPER_SHM* shm, bool replace) {
+    (void)replace;
+    // the object name has no leading slash on Windows
+    const char* name = shm->name[0] == '/' ? shm->name + 1 : shm->name;
+    shm->mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0,
+                                      sizeof(FLIPPER_SHM_HEADER), name);
+    if (!shm->mapping) {
+        printf("flipper_shm_create: can't create %s\n", shm->name);
+        return NULL;
+    }
+    if (GetLastError() == ERROR_ALREADY_EXISTS) {
+        printf("flipper_shm_create: %s is used by another process\n", shm->name);
+        CloseHandle(shm->mapping);
+        return NULL;
+    }
+    void* p = MapViewOfFile(shm->mapping, FILE_MAP_WRITE, 0, 0, sizeof(FLIPPER_SHM_HEADER));
+    if (!p) {
+        printf("flipper_shm_create: can't map %s\n", shm->name);
+        CloseHandle(shm->mapping);
+    }
+    return p;
+}
+
+static void shm_unmap(FLIPPER_SHM* shm) {
+    UnmapViewOfFile(shm->header);
+    CloseHandle(shm->mapping);
+}
+
+#else
+
+static void* shm_map(FLIPPER_SHM* shm, bool replace) {
+    // taking over the name of a live simulator would leave its viewers and drivers on an
+    // orphaned object, so only replace when asked to, e.g. after a crash
+    if (replace)
+        shm_unlink(shm->name);
+    int fd = shm_open(shm->name, O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) {
+        if (errno == EEXIST) {
+            printf("flipper_shm_create: %s exists, another simulator may be using it. "
+                   "FLIPPER_SIM_SHM_REPLACE=1 replaces it\n",
+                   shm->name);
+        } else {
+            printf("flipper_shm_create: can't create %s: %s\n", shm->name, strerror(errno));
+        }
+        return NULL;
+    }
+
+    void* p = NULL;
+    if (ftruncate(fd, sizeof(FLIPPER_SHM_HEADER)) == 0) {
+        p = mmap(NULL, sizeof(FLIPPER_SHM_HEADER), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED)
+            p = NULL;
+    }
+    close(fd);
+    if (!p) {
+        printf("flipper_shm_create: can't map %s\n", shm->name);
+        shm_unlink(shm->name);
+    }
+    return p;
+}
+
+static void shm_unmap(FLIPPER_SHM* shm) {
+    munmap(shm->header, sizeof(FLIPPER_SHM_HEADER));
+    shm_unlink(shm->name);
+}
+
+#endif
+
+FLIPPER_SHM* flipper_shm_create(const char* name, int flags) {
+    FLIPPER_SHM* shm = (FLIPPER_SHM*)SDL_calloc(1, sizeof(FLIPPER_SHM));
+    if (!shm) {
+        printf("flipper_shm_create: calloc\n");
+        return NULL;
+    }
+    shm->name = SDL_strdup(name);
+    if (shm->name)
+        shm->header = (FLIPPER_SHM_HEADER*)shm_map(shm, (flags & FL_SHM_REPLACE) != 0);
+    if (!shm->header) {
+        SDL_free(shm->name);
+        SDL_free(shm);
+        return NULL;
+    }
+
+    // new objects are zeroed, the magic goes last so readers never see a half written header
+    FLIPPER_SHM_HEADER* header = shm->header;
+    header->version = FLIPPER_SHM_VERSION;
+    header->slots = FLIPPER_SHM_SLOTS;
+    header->width = FL_LCD_WIDTH;
+    header->height = FL_LCD_HEIGHT;
+    header->frame_size = FLIPPER_SHM_FRAME_SIZE;
+    SDL_MemoryBarrierRelease();
+    memcpy(header->magic, "FLFB", 4);
+    return shm;
+}
+
+void flipper_shm_destroy(FLIPPER_SHM* shm) {
+    if (!shm)
+        return;
+    shm_unmap(shm);
+    SDL_free(shm->name);
+    SDL_free(shm);
+}
+
+// SDL_AtomicSet is only an acquire barrier with gcc and clang, the release barriers keep the
+// slot stores strictly between the odd and the even seq store
+void flipper_shm_publish(FLIPPER_SHM* shm, uint32_t frame, uint64_t time_us,
+                         const uint8_t* lcd) {
+    int i = frame % FLIPPER_SHM_SLOTS;
+    FLIPPER_SHM_SLOT* slot = &shm->header->slot[i];
+
+    SDL_AtomicSet(&slot->seq, (int)++shm->seq[i]);
+    SDL_MemoryBarrierRelease();
+    slot->frame = frame;
+    slot->time_us = time_us;
+    memcpy(slot->lcd, lcd, FLIPPER_SHM_FRAME_SIZE);
+    SDL_MemoryBarrierRelease();
+    SDL_AtomicSet(&slot->seq, (int)++shm->seq[i]);
+
+    SDL_AtomicSet(&shm->header->frames, (int)(frame + 1));
+}
+
+bool flipper_shm_poll(FLIPPER_SHM* shm, FLIPPER_SHM_INPUT_EVENT* event) {
+    FLIPPER_SHM_INPUT* input = &shm->header->input;
+    if (shm->input_tail == shm->input_head) {
+        shm->input_head = (uint32_t)SDL_AtomicGet(&input->head);
+        if (shm->input_tail == shm->input_head)
+            return false;
+        SDL_MemoryBarrierAcquire();  // the events up to head were written before it
+        // a driver that doesn't check for a full mailbox overwrote the oldest events
+        if (shm->input_head - shm->input_tail > FLIPPER_SHM_INPUT_SIZE)
+            shm->input_tail = shm->input_head - FLIPPER_SHM_INPUT_SIZE;
+    }
+
+    *event = input->events[shm->input_tail % FLIPPER_SHM_INPUT_SIZE];
+    SDL_MemoryBarrierRelease();  // read the event before the driver may reuse its slot
+    SDL_AtomicSet(&input->tail, (int)++shm->input_tail);
+    return true;
+}
+
+bool flipper_shm_inject(FLIPPER_SHM_HEADER* header, int pin, bool down) {
+    FLIPPER_SHM_INPUT* input = &header->input;
+    uint32_t head = (uint32_t)input->head.value;  // only the driver writes it
+    if (head - (uint32_t)SDL_AtomicGet(&input->tail) >= FLIPPER_SHM_INPUT_SIZE)
+        return false;
+    SDL_MemoryBarrierAcquire();  // the simulator is done with the slot
+
+    FLIPPER_SHM_INPUT_EVENT* event = &input->events[head % FLIPPER_SHM_INPUT_SIZE];
+    event->pin = (uint8_t)pin;
+    event->down = down;
+    event->reserved = 0;
+    SDL_MemoryBarrierRelease();  // SDL_AtomicSet alone doesn't order the event before head
+    SDL_AtomicSet(&input->head, (int)(head + 1));
+    return true;
+}
+
+// plain loads and barriers only, SDL_AtomicGet may write and the mapping can be read-only
+static uint32_t load_seq(const FLIPPER_SHM_SLOT* slot) {
+    return *(const volatile uint32_t*)&slot->seq.value;
+}
+
+bool flipper_shm_read(const FLIPPER_SHM_HEADER* header, uint32_t frame, FLIPPER_SHM_SLOT* out) {
+    const FLIPPER_SHM_SLOT* slot = &header->slot[frame % FLIPPER_SHM_SLOTS];
+    for (int attempt = 0; attempt < READ_ATTEMPTS; attempt++) {
+        uint32_t seq = load_seq(slot);
+        if (seq & 1)
+            continue;
+        SDL_MemoryBarrierAcquire();
+        memcpy(out, (const void*)slot, sizeof(*out));
+        SDL_MemoryBarrierAcquire();
+        if (load_seq(slot) == seq)
+            return out->frame == frame;
+    }
+    return false;
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+// Shared memory for viewers, test rigs and drivers in other processes: every frame passed to
+// flipper_lcd_update is published into a ring of FLIPPER_SHM_SLOTS frames, and button
+// changes written into an input mailbox are applied by flipper_gpio_update. It is a POSIX
+// shared-memory object (a named file mapping on Windows) that viewers map read-only and
+// drivers read-write, neither side needs calls into the other or syscalls per frame.
+//
+// Frame n goes to slot n % FLIPPER_SHM_SLOTS. Every slot is a seqlock: the writer makes seq
+// odd, writes the slot and makes seq even again. A reader loads seq, reads the slot and
+// loads seq again, the slot was consistent if both are the same even value (see
+// flipper_shm_read). header.frames is the latest frame number + 1, readers that poll
+// at least every FLIPPER_SHM_SLOTS frames see every frame.
+//
+// The mailbox is a ring of FLIPPER_SHM_INPUT_SIZE events for a single driver: it writes the
+// event at head % size and then increments head, the simulator applies the events up to head
+// in the next flipper_gpio_update and advances tail past them. The ring is full when
+// head - tail is the size (see flipper_shm_inject). Events are ignored while an input log is
+// replayed, FL_GPIO_SIMULATOR_EXIT stops the app.
+//
+//   header: "FLFB" | u16 version | u16 slots | u16 width | u16 height | u32 frame bytes
+//           | u32 frames | u32 reserved | slots | input
+//   slot:   u32 seq | u32 frame number | u64 time us | frame bytes of lcd pages
+//   input:  u32 head | u32 tail | events of u8 pin, u8 down (1 pressed), u16 reserved
+//
+// lcd pages are FL_LCD_PAGES rows of FL_LCD_WIDTH bytes, bit 0 of a byte is the top pixel.
+// All values are in the byte order of the machine.
+
+#include <SDL.h>
+
+#include "flipper.h"
+
+#define FLIPPER_SHM_VERSION 2
+#define FLIPPER_SHM_SLOTS 8
+#define FLIPPER_SHM_FRAME_SIZE (FL_LCD_PAGES * FL_LCD_WIDTH)
+#define FLIPPER_SHM_INPUT_SIZE 64  // power of 2
+
+typedef struct FLIPPER_SHM_SLOT FLIPPER_SHM_SLOT;
+struct FLIPPER_SHM_SLOT {
+    SDL_atomic_t seq;
+    uint32_t frame;
+    uint64_t time_us;  // flipper_get_time_us of the frame
+    uint8_t lcd[FLIPPER_SHM_FRAME_SIZE];
+};
+
+typedef struct FLIPPER_SHM_INPUT_EVENT FLIPPER_SHM_INPUT_EVENT;
+struct FLIPPER_SHM_INPUT_EVENT {
+    uint8_t pin;  // FL_GPIO_*
+    uint8_t down;
+    uint16_t reserved;
+};
+
+typedef struct FLIPPER_SHM_INPUT FLIPPER_SHM_INPUT;
+struct FLIPPER_SHM_INPUT {
+    SDL_atomic_t head;  // events written by the driver
+    SDL_atomic_t tail;  // events taken by the simulator
+    FLIPPER_SHM_INPUT_EVENT events[FLIPPER_SHM_INPUT_SIZE];
+};
+
+typedef struct FLIPPER_SHM_HEADER FLIPPER_SHM_HEADER;
+struct FLIPPER_SHM_HEADER {
+    char magic[4];
+    uint16_t version;
+    uint16_t slots;
+    uint16_t width;
+    uint16_t height;
+    uint32_t frame_size;
+    SDL_atomic_t frames;
+    uint32_t reserved;
+    FLIPPER_SHM_SLOT slot[FLIPPER_SHM_SLOTS];
+    FLIPPER_SHM_INPUT input;
+};
+
+typedef struct FLIPPER_SHM FLIPPER_SHM;
+
+// name is a shared-memory object name like "/flipper", it fails if the object exists unless
+// flags has FL_SHM_REPLACE. The object is removed again by flipper_shm_destroy, readers keep
+// their mapping.
+FLIPPER_SHM* flipper_shm_create(const char* name, int flags);
+void flipper_shm_destroy(FLIPPER_SHM* shm);
+
+void flipper_shm_publish(FLIPPER_SHM* shm, uint32_t frame, uint64_t time_us,
+                         const uint8_t* lcd);
+
+// takes the next event written by the driver, false if there is none
+bool flipper_shm_poll(FLIPPER_SHM* shm, FLIPPER_SHM_INPUT_EVENT* event);
+
+// reader side: copies frame out of a mapped header, false if the slot holds another frame
+// by now or the writer kept changing it
+bool flipper_shm_read(const FLIPPER_SHM_HEADER* header, uint32_t frame, FLIPPER_SHM_SLOT* out);
+
+// driver side: queues a button change in a header mapped read-write, false if the mailbox
+// is full
+bool flipper_shm_inject(FLIPPER_SHM_HEADER* header, int pin, bool down);
@@ -0,0 +1,73 @@
+#include "flipper_stats.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char* phase_names[FL_PHASE_COUNT] = {
+    "app", "background", "highlight", "upload", "present", "sleep", "frame",
+};
+
+void flipper_stats_init(FLIPPER_STATS* stats, bool enabled) {
+    memset(stats, 0, sizeof(*stats));
+    stats->enabled = enabled;
+    stats->frequency = SDL_GetPerformanceFrequency();
+}
+
+uint64_t flipper_stats_add(FLIPPER_STATS* stats, int phase, uint64_t start, uint64_t end) {
+    if (!stats->enabled || start == 0)
+        return end;
+
+    stats->total[phase] += end - start;
+    uint64_t us = (end - start) * 1000000 / stats->frequency;
+    uint32_t i = stats->count[phase]++ & (FLIPPER_STATS_SAMPLES - 1);
+    stats->samples[phase][i] = us > UINT32_MAX ? UINT32_MAX : (uint32_t)us;
+    return end;
+}
+
+const char* flipper_stats_phase_name(int phase) {
+    return phase_names[phase];
+}
+
+static int compare_u32(const void* a, const void* b) {
+    uint32_t x = *(const uint32_t*)a;
+    uint32_t y = *(const uint32_t*)b;
+    return (x > y) - (x < y);
+}
+
+void flipper_stats_compute(const FLIPPER_STATS* stats, int phase, FLIPPER_PHASE_STATS* out) {
+    memset(out, 0, sizeof(*out));
+    out->name = flipper_stats_phase_name(phase);
+
+    int n = stats->count[phase] < FLIPPER_STATS_SAMPLES ? stats->count[phase]
+                                                        : FLIPPER_STATS_SAMPLES;
+    out->samples = n;
+    if (n == 0)
+        return;
+
+    uint32_t sorted[FLIPPER_STATS_SAMPLES];
+    memcpy(sorted, stats->samples[phase], n * sizeof(uint32_t));
+    qsort(sorted, n, sizeof(uint32_t), compare_u32);
+
+    uint64_t sum = 0;
+    for (int i = 0; i < n; i++) {
+        sum += sorted[i];
+    }
+    out->mean_us = (double)sum / n;
+    out->p50_us = sorted[(n - 1) * 50 / 100];
+    out->p99_us = sorted[(n - 1) * 99 / 100];
+    out->max_us = sorted[n - 1];
+}
+
+void flipper_stats_dump(const FLIPPER_STATS* stats) {
+    printf("%-12s %8s %10s %8s %8s %8s\n", "phase [us]", "samples", "mean", "p50", "p99",
+           "max");
+    for (int phase = 0; phase < FL_PHASE_COUNT; phase++) {
+        FLIPPER_PHASE_STATS s;
+        flipper_stats_compute(stats, phase, &s);
+        if (s.samples == 0)
+            continue;
+        printf("%-12s %8d %10.1f %8u %8u %8u\n", s.name, s.samples, s.mean_us, s.p50_us,
+               s.p99_us, s.max_us);
+    }
+}
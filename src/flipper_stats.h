@@ -0,0 +1,34 @@
+#pragma once
+
+// Per-phase frame timing. The last FLIPPER_STATS_SAMPLES durations of every phase are kept
+// in ring buffers, percentiles are only computed when asked for.
+
+#include <SDL.h>
+
+#include "flipper.h"
+
+#define FLIPPER_STATS_SAMPLES 1024  // power of 2
+
+typedef struct FLIPPER_STATS FLIPPER_STATS;
+struct FLIPPER_STATS {
+    bool enabled;
+    uint64_t frequency;
+    uint64_t app_start;    // end of the previous frame, start of app logic
+    uint64_t frame_start;  // start of the previous flipper_lcd_update
+    uint32_t count[FL_PHASE_COUNT];
+    uint32_t samples[FL_PHASE_COUNT][FLIPPER_STATS_SAMPLES];  // microseconds
+    uint64_t total[FL_PHASE_COUNT];                           // counter ticks, all frames
+};
+
+void flipper_stats_init(FLIPPER_STATS* stats, bool enabled);
+
+static inline uint64_t flipper_stats_now(FLIPPER_STATS* stats) {
+    return stats->enabled ? SDL_GetPerformanceCounter() : 0;
+}
+
+// add the duration end - start to a phase, returns end
+uint64_t flipper_stats_add(FLIPPER_STATS* stats, int phase, uint64_t start, uint64_t end);
+
+const char* flipper_stats_phase_name(int phase);
+void flipper_stats_compute(const FLIPPER_STATS* stats, int phase, FLIPPER_PHASE_STATS* out);
+void flipper_stats_dump(const FLIPPER_STATS* stats);
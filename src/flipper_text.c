@@ -0,0 +1,104 @@
+// Text drawn with the micro4x6 font. The xbm is decoded once into lcd sprites for both
+// orientations, strings are drawn as one background fill plus one blit per glyph.
+
+#include <SDL.h>
+#include <string.h>
+
+#include "flipper.h"
+#include "flipper_ctx.h"
+
+#include "../img/micro4x6.xbm"
+
+#if font_glyph_width != FL_FONT_WIDTH || font_glyph_height != FL_FONT_HEIGHT
+#error "font size doesn't match FL_FONT_WIDTH / FL_FONT_HEIGHT"
+#endif
+
+#define NUM_GLYPHS (font_columns * font_rows)
+
+// glyph pixels set in the font are background, the glyph cells are opaque
+static uint8_t glyph_columns[NUM_GLYPHS][FL_FONT_WIDTH];  // byte per glyph column, bit = row
+static uint8_t glyph_rows[NUM_GLYPHS][FL_FONT_HEIGHT];    // rotated: byte per row, bit = column
+static bool font_decoded;
+static SDL_SpinLock font_lock;
+
+void flipper_text_init() {
+    SDL_AtomicLock(&font_lock);
+    if (!font_decoded) {
+        for (int c = 0; c < NUM_GLYPHS; c++) {
+            int py = (c / font_columns) * font_glyph_height;
+            int px = (c % font_columns) * font_glyph_width;
+            for (int j = 0; j < FL_FONT_HEIGHT; j++) {
+                for (int i = 0; i < FL_FONT_WIDTH; i++) {
+                    int xx = px + i;
+                    int bits = font_bits[(py + j) * font_width / 8 + xx / 8];
+                    if (!((bits >> (xx & 7)) & 1)) {
+                        glyph_columns[c][i] |= 1 << j;
+                        glyph_rows[c][j] |= 1 << i;
+                    }
+                }
+            }
+        }
+        font_decoded = true;
+    }
+    SDL_AtomicUnlock(&font_lock);
+}
+
+static int text_draw(FLIPPER_CTX* ctx, int x, int y, const char* s, int len, int flags) {
+    bool rotate = (flags & FL_TEXT_ROTATE) != 0;
+    int ink = (flags & FL_TEXT_INVERT) ? FL_DRAW_CLEAR : FL_DRAW_OR;
+    int background = (flags & FL_TEXT_INVERT) ? FL_DRAW_OR : FL_DRAW_CLEAR;
+
+    if (rotate)
+        flipper_ctx_draw_fill_rect(ctx, y, x, FL_FONT_HEIGHT, len * FL_FONT_WIDTH, background);
+    else
+        flipper_ctx_draw_fill_rect(ctx, x, y, len * FL_FONT_WIDTH, FL_FONT_HEIGHT, background);
+
+    for (int i = 0; i < len; i++, x += FL_FONT_WIDTH) {
+        unsigned char c = (unsigned char)s[i];
+        if (c >= NUM_GLYPHS)
+            continue;
+
+        FLIPPER_SPRITE glyph;
+        if (rotate) {
+            glyph.width = FL_FONT_HEIGHT;
+            glyph.height = FL_FONT_WIDTH;
+            glyph.data = glyph_rows[c];
+            flipper_ctx_draw_blit(ctx, y, x, &glyph, ink);
+        } else {
+            glyph.width = FL_FONT_WIDTH;
+            glyph.height = FL_FONT_HEIGHT;
+            glyph.data = glyph_columns[c];
+            flipper_ctx_draw_blit(ctx, x, y, &glyph, ink);
+        }
+    }
+    return x;
+}
+
+int flipper_ctx_text_draw(FLIPPER_CTX* ctx, int x, int y, const char* s, int flags) {
+    return text_draw(ctx, x, y, s, (int)strlen(s), flags);
+}
+
+int flipper_ctx_text_draw_int(FLIPPER_CTX* ctx, int right, int y, int value, int flags) {
+    // digits are produced from the end, no printf
+    char digits[12];
+    int n = 0;
+    unsigned int u = value < 0 ? 0u - (unsigned int)value : (unsigned int)value;
+    do {
+        digits[sizeof(digits) - 1 - n++] = (char)('0' + u % 10);
+        u /= 10;
+    } while (u > 0);
+    if (value < 0)
+        digits[sizeof(digits) - 1 - n++] = '-';
+
+    int x = right - n * FL_FONT_WIDTH;
+    text_draw(ctx, x, y, &digits[sizeof(digits) - n], n, flags);
+    return x;
+}
+
+int flipper_text_draw(int x, int y, const char* s, int flags) {
+    return flipper_ctx_text_draw(flipper_ctx_get_current(), x, y, s, flags);
+}
+
+int flipper_text_draw_int(int right, int y, int value, int flags) {
+    return flipper_ctx_text_draw_int(flipper_ctx_get_current(), right, y, value, flags);
+}
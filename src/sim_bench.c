@@ -0,0 +1,303 @@
+// Microbenchmarks of the simulator API and the game kernels.
+// usage: sim_bench [-f filter] [-t min_seconds] [-o results.json]
+//
+// Prints a table and optionally writes the results in the JSON format of Google Benchmark,
+// so the usual tools (compare.py) can diff two runs. Run from the directory containing img/,
+// the software lcd_update benchmarks need a window, without a display they use SDL's
+// offscreen driver.
+
+#define SDL_MAIN_HANDLED
+
+#include <SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "flipper.h"
+#include "flipper_ctx.h"
+#include "sim_bench.h"
+
+#define MAX_ITERATIONS 1000000000
+
+#ifdef NDEBUG
+#define BUILD_TYPE "release"
+#else
+#define BUILD_TYPE "debug"
+#endif
+
+volatile uint64_t bench_sink;
+
+void bench_reset_timer(BENCH_STATE* state) {
+    state->start = SDL_GetPerformanceCounter();
+    state->cpu_start = clock();
+}
+
+// a diagonal walk over the lcd, so every page and bit is hit
+#define WALK_X(i) ((int)((i) * 5 % FL_LCD_WIDTH))
+#define WALK_Y(i) ((int)((i) * 3 % FL_LCD_HEIGHT))
+
+static void bench_pixel_set(BENCH_STATE* state) {
+    for (int64_t i = 0; i < state->iterations; i++) {
+        flipper_pixel_set(WALK_X(i), WALK_Y(i));
+    }
+    state->items = state->iterations;
+}
+
+static void bench_pixel_clear(BENCH_STATE* state) {
+    for (int64_t i = 0; i < state->iterations; i++) {
+        flipper_pixel_clear(WALK_X(i), WALK_Y(i));
+    }
+    state->items = state->iterations;
+}
+
+static void bench_pixel_get(BENCH_STATE* state) {
+    uint64_t set = 0;
+    for (int64_t i = 0; i < state->iterations; i++) {
+        set += flipper_pixel_get(WALK_X(i), WALK_Y(i));
+    }
+    bench_sink += set;
+    state->items = state->iterations;
+}
+
+static void bench_pixel_reset(BENCH_STATE* state) {
+    for (int64_t i = 0; i < state->iterations; i++) {
+        flipper_pixel_reset();
+    }
+}
+
+static void bench_gpio_update(BENCH_STATE* state) {
+    for (int64_t i = 0; i < state->iterations; i++) {
+        flipper_gpio_update();
+    }
+    bench_sink += flipper_gpio_get(FL_GPIO_BUTTON_UP);
+}
+
+// one page changes every frame, as in most game frames
+static void lcd_update(FLIPPER_CTX* ctx, BENCH_STATE* state, bool dirty) {
+    for (int64_t i = 0; i < state->iterations; i++) {
+        if (dirty)
+            flipper_ctx_pixel_set(ctx, WALK_X(i), WALK_Y(i));
+        flipper_ctx_lcd_update(ctx);
+    }
+    state->items = state->iterations;
+}
+
+static void bench_lcd_update_headless(BENCH_STATE* state) {
+    lcd_update(flipper_ctx_get_current(), state, true);
+}
+
+static void lcd_update_software(BENCH_STATE* state, bool dirty) {
+    FLIPPER_CTX* ctx = flipper_ctx_create(0);
+    if (!ctx) {
+        state->error = "can't create a window";
+        return;
+    }
+    flipper_ctx_lcd_update(ctx);
+    bench_reset_timer(state);
+    lcd_update(ctx, state, dirty);
+    flipper_ctx_destroy(ctx);
+}
+
+static void bench_lcd_update_software(BENCH_STATE* state) {
+    lcd_update_software(state, true);
+}
+
+static void bench_lcd_update_software_unchanged(BENCH_STATE* state) {
+    lcd_update_software(state, false);
+}
+
+static const BENCH sim_bench_flipper[] = {
+    { "flipper/pixel_set", bench_pixel_set },
+    { "flipper/pixel_clear", bench_pixel_clear },
+    { "flipper/pixel_get", bench_pixel_get },
+    { "flipper/pixel_reset", bench_pixel_reset },
+    { "flipper/gpio_update", bench_gpio_update },
+    { "flipper/lcd_update/headless", bench_lcd_update_headless },
+    { "flipper/lcd_update/software", bench_lcd_update_software },
+    { "flipper/lcd_update/software_unchanged", bench_lcd_update_software_unchanged },
+    { NULL, NULL },
+};
+
+static const BENCH* const bench_sets[] = { sim_bench_flipper, sim_bench_snake, sim_bench_tetris };
+
+typedef struct RESULT RESULT;
+struct RESULT {
+    const char* name;
+    const char* error;
+    int64_t iterations;
+    double real_ns;  // per iteration
+    double cpu_ns;
+    double items_per_second;
+};
+
+// every benchmark gets a fresh headless instance with the same seed
+static void run_once(const BENCH* bench, BENCH_STATE* state, double* seconds, double* cpu) {
+    FLIPPER_CTX* ctx = flipper_ctx_create(FL_INIT_HEADLESS | FL_INIT_VIRTUAL_CLOCK);
+    flipper_ctx_random_seed(ctx, 1);
+    flipper_ctx_make_current(ctx);
+
+    bench_reset_timer(state);
+    bench->func(state);
+    uint64_t end = SDL_GetPerformanceCounter();
+    clock_t cpu_end = clock();
+
+    *seconds = (double)(end - state->start) / (double)SDL_GetPerformanceFrequency();
+    *cpu = (double)(cpu_end - (clock_t)state->cpu_start) / CLOCKS_PER_SEC;
+
+    flipper_ctx_make_current(NULL);
+    flipper_ctx_destroy(ctx);
+}
+
+// like Google Benchmark: grow the iterations by the measured rate until a run is long enough
+static RESULT run(const BENCH* bench, double min_time) {
+    RESULT result = { bench->name, NULL, 0, 0, 0, 0 };
+    int64_t iterations = 1;
+    for (;;) {
+        BENCH_STATE state = { iterations, 0, NULL, 0, 0 };
+        double seconds, cpu;
+        run_once(bench, &state, &seconds, &cpu);
+        if (state.error) {
+            result.error = state.error;
+            return result;
+        }
+        if (seconds >= min_time || iterations >= MAX_ITERATIONS) {
+            result.iterations = iterations;
+            result.real_ns = seconds * 1e9 / iterations;
+            result.cpu_ns = cpu * 1e9 / iterations;
+            if (state.items && seconds > 0)
+                result.items_per_second = state.items / seconds;
+            return result;
+        }
+        double multiplier = seconds > 0 ? min_time * 1.4 / seconds : 10;
+        if (multiplier > 10 || seconds / min_time <= 0.1)
+            multiplier = 10;
+        int64_t next = (int64_t)(iterations * multiplier);
+        iterations = next > iterations ? next : iterations + 1;
+        if (iterations > MAX_ITERATIONS)
+            iterations = MAX_ITERATIONS;
+    }
+}
+
+static void write_json_string(FILE* f, const char* s) {
+    fputc('"', f);
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\')
+            fprintf(f, "\\%c", c);
+        else if (c < 0x20)
+            fprintf(f, "\\u%04x", c);
+        else
+            fputc(c, f);
+    }
+    fputc('"', f);
+}
+
+static bool write_json(const char* path, const char* executable, const RESULT* results,
+                       int count) {
+    FILE* f = fopen(path, "w");
+    if (!f) {
+        printf("write_json: can't open %s\n", path);
+        return false;
+    }
+
+    char date[64];
+    time_t now = time(NULL);
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S%z", localtime(&now));
+
+    fprintf(f, "{\n  \"context\": {\n");
+    fprintf(f, "    \"date\": \"%s\",\n", date);
+    fprintf(f, "    \"executable\": ");
+    write_json_string(f, executable);
+    fprintf(f, ",\n");
+    fprintf(f, "    \"num_cpus\": %d,\n", SDL_GetCPUCount());
+    fprintf(f, "    \"library_build_type\": \"%s\"\n", BUILD_TYPE);
+    fprintf(f, "  },\n  \"benchmarks\": [");
+    for (int i = 0; i < count; i++) {
+        const RESULT* r = &results[i];
+        fprintf(f, "%s\n    {\n", i ? "," : "");
+        fprintf(f, "      \"name\": \"%s\",\n", r->name);
+        fprintf(f, "      \"run_name\": \"%s\",\n", r->name);
+        fprintf(f, "      \"run_type\": \"iteration\",\n");
+        fprintf(f, "      \"repetitions\": 1,\n");
+        fprintf(f, "      \"repetition_index\": 0,\n");
+        fprintf(f, "      \"threads\": 1,\n");
+        if (r->error) {
+            fprintf(f, "      \"error_occurred\": true,\n");
+            fprintf(f, "      \"error_message\": ");
+            write_json_string(f, r->error);
+            fprintf(f, "\n    }");
+            continue;
+        }
+        fprintf(f, "      \"iterations\": %lld,\n", (long long)r->iterations);
+        fprintf(f, "      \"real_time\": %.6g,\n", r->real_ns);
+        fprintf(f, "      \"cpu_time\": %.6g,\n", r->cpu_ns);
+        fprintf(f, "      \"time_unit\": \"ns\"");
+        if (r->items_per_second > 0)
+            fprintf(f, ",\n      \"items_per_second\": %.6g", r->items_per_second);
+        fprintf(f, "\n    }");
+    }
+    fprintf(f, "\n  ]\n}\n");
+
+    bool ok = !ferror(f);
+    if (fclose(f) != 0)
+        ok = false;
+    if (!ok)
+        printf("write_json: can't write %s\n", path);
+    return ok;
+}
+
+static void usage() {
+    printf("usage: sim_bench [-f filter] [-t min_seconds] [-o results.json]\n");
+}
+
+int main(int argc, char** argv) {
+    const char* filter = NULL;
+    const char* json = NULL;
+    double min_time = 0.5;
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc) {
+            usage();
+            return 1;
+        }
+        if (!strcmp(argv[i], "-f"))
+            filter = argv[++i];
+        else if (!strcmp(argv[i], "-t"))
+            min_time = atof(argv[++i]);
+        else if (!strcmp(argv[i], "-o"))
+            json = argv[++i];
+        else {
+            usage();
+            return 1;
+        }
+    }
+    if (min_time <= 0)
+        min_time = 0.5;
+
+    // the software benchmarks need a window, the offscreen driver works without a display
+    SDL_setenv("SDL_VIDEODRIVER", "offscreen", 0);
+
+    RESULT results[64];
+    int count = 0;
+    printf("%-45s %12s %12s %12s\n", "benchmark", "time", "cpu", "iterations");
+    for (size_t s = 0; s < sizeof(bench_sets) / sizeof(bench_sets[0]); s++) {
+        for (const BENCH* bench = bench_sets[s]; bench->name; bench++) {
+            if (filter && !strstr(bench->name, filter))
+                continue;
+            if (count == sizeof(results) / sizeof(results[0]))
+                break;
+            RESULT r = run(bench, min_time);
+            results[count++] = r;
+            if (r.error)
+                printf("%-45s ERROR: %s\n", r.name, r.error);
+            else
+                printf("%-45s %9.1f ns %9.1f ns %12lld\n", r.name, r.real_ns, r.cpu_ns,
+                       (long long)r.iterations);
+        }
+    }
+
+    if (json && !write_json(json, argv[0], results, count))
+        return 1;
+    return 0;
+}
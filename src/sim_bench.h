@@ -0,0 +1,36 @@
+#pragma once
+
+// Microbenchmarks in the style of Google Benchmark: a benchmark runs its loop
+// state->iterations times, the runner raises the count until one run takes the minimum time
+// and reports the time per iteration.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct BENCH_STATE BENCH_STATE;
+struct BENCH_STATE {
+    int64_t iterations;
+    int64_t items;      // items processed in all iterations, 0 if not meaningful
+    const char* error;  // set to skip the benchmark, e.g. without a window
+    uint64_t start;     // performance counter at the start of the timed part
+    uint64_t cpu_start;
+};
+
+typedef void (*BENCH_FUNC)(BENCH_STATE* state);
+
+typedef struct BENCH BENCH;
+struct BENCH {
+    const char* name;
+    BENCH_FUNC func;
+};
+
+// excludes the setup before it from the measurement
+void bench_reset_timer(BENCH_STATE* state);
+
+// results are added here so the compiler can't drop the measured calls
+extern volatile uint64_t bench_sink;
+
+// NULL terminated lists, the app benchmarks run with a headless instance made current
+extern const BENCH sim_bench_snake[];
+extern const BENCH sim_bench_tetris[];
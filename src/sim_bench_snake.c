@@ -0,0 +1,32 @@
+// Benchmarks of the snake kernels, built from the unchanged snake.c.
+
+#include "sim_bench.h"
+
+#define main snake_main
+#include "snake.c"
+#undef main
+
+// a long snake across the field, as fruit_new_pos sees it late in a game
+static void draw_snake(void) {
+    flipper_pixel_reset();
+    draw_border();
+    for (int y = 4; y < FL_LCD_HEIGHT - 4; y += 4) {
+        for (int x = 2; x < FL_LCD_WIDTH - 2; x += 2)
+            draw_x4(x, y);
+    }
+}
+
+static void bench_fruit_new_pos(BENCH_STATE* state) {
+    draw_snake();
+    POINT fruit;
+    bench_reset_timer(state);
+    for (int64_t i = 0; i < state->iterations; i++) {
+        fruit_new_pos(&fruit);
+        bench_sink += fruit.x;
+    }
+}
+
+const BENCH sim_bench_snake[] = {
+    { "snake/fruit_new_pos", bench_fruit_new_pos },
+    { NULL, NULL },
+};
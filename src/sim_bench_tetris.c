@@ -0,0 +1,85 @@
+// Benchmarks of the tetris kernels, built from the unchanged tetris.c.
+
+#include "sim_bench.h"
+
+#define main tetris_main
+#include "tetris.c"
+#undef main
+
+// the lower half filled with gaps, the rows below 16 nearly full
+static void field_init(GAME *g) {
+    game_init(g);
+    for (int y = GRID_HEIGHT / 2; y < GRID_HEIGHT; y++) {
+        int gap = (y * 7) % GRID_WIDTH;
+        g->field[y] = FULL_ROW & ~(1 << gap);
+        if (y < 16)
+            g->field[y] &= ~(1 << ((gap + 3) % GRID_WIDTH));
+    }
+    game_rand_piece(g);
+}
+
+static void bench_valid_block(BENCH_STATE* state) {
+    GAME g;
+    field_init(&g);
+    bench_reset_timer(state);
+    for (int64_t i = 0; i < state->iterations; i++) {
+        BLOCK b;
+        b.piece = i % NUM_PIECES;
+        b.rotation = (i >> 3) & 3;
+        b.position.x = (int)(i % (GRID_WIDTH + 2)) - 2;
+        b.position.y = (int)(i % GRID_HEIGHT) - 1;
+        bench_sink += valid_block(&g, &b);
+    }
+    state->items = state->iterations;
+}
+
+static void bench_find_shadow(BENCH_STATE* state) {
+    GAME g;
+    field_init(&g);
+    bench_reset_timer(state);
+    for (int64_t i = 0; i < state->iterations; i++) {
+        BLOCK b;
+        b.piece = i % NUM_PIECES;
+        b.rotation = (i >> 3) & 3;
+        b.position.x = (int)(i % (GRID_WIDTH - 3));
+        b.position.y = -1;
+        find_shadow(&g, &b);
+        bench_sink += b.position.y;
+    }
+}
+
+static void bench_freeze_block_on_field(BENCH_STATE* state) {
+    GAME start;
+    field_init(&start);
+    // an I dropped into the gap of the nearly full rows removes lines
+    start.block.piece = PIECE_I;
+    start.block.rotation = 1;
+    start.block.position.x = 0;
+    find_shadow(&start, &start.block);
+    bench_reset_timer(state);
+    for (int64_t i = 0; i < state->iterations; i++) {
+        GAME g = start;
+        g.block.position.x = (int)(i % (GRID_WIDTH - 3)) - 2;
+        find_shadow(&g, &g.block);
+        freeze_block_on_field(&g);
+        bench_sink += g.score;
+    }
+}
+
+static void bench_draw_field(BENCH_STATE* state) {
+    GAME g;
+    field_init(&g);
+    bench_reset_timer(state);
+    for (int64_t i = 0; i < state->iterations; i++) {
+        draw_field(&g);
+    }
+    bench_sink += flipper_pixel_get(GRID_Y + GRID_HEIGHT * GRID_SY - 3, GRID_X + 2);
+}
+
+const BENCH sim_bench_tetris[] = {
+    { "tetris/valid_block", bench_valid_block },
+    { "tetris/find_shadow", bench_find_shadow },
+    { "tetris/freeze_block_on_field", bench_freeze_block_on_field },
+    { "tetris/draw_field", bench_draw_field },
+    { NULL, NULL },
+};
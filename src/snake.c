@@ -28,7 +28,7 @@ typedef struct {
     int direction;
 } SNAKE;
 
-POINT direction_delta[4] = {
+static POINT direction_delta[4] = {
     { 1, 0 },   // right
     { 0, 1 },   // down
     { -1, 0 },  // left
@@ -37,14 +37,14 @@ POINT direction_delta[4] = {
 
 #define BUTTONS 4
 
-int buttons[BUTTONS] = {
+static int buttons[BUTTONS] = {
     FL_GPIO_BUTTON_RIGHT,
     FL_GPIO_BUTTON_DOWN,
     FL_GPIO_BUTTON_LEFT,
     FL_GPIO_BUTTON_UP,
 };
 
-void snake_init(SNAKE* s) {
+static void snake_init(SNAKE* s) {
     s->len = 0;
     s->tail = 0;
     s->head = 0;
@@ -55,38 +55,28 @@ void snake_init(SNAKE* s) {
     s->direction = SNAKE_RIGHT;
 }
 
-void draw_border() {
-    for (int i = 0; i < FL_LCD_WIDTH; i++) {
-        flipper_pixel_set(i, 0);
-        flipper_pixel_set(i, FL_LCD_HEIGHT - 1);
-        if (i < FL_LCD_HEIGHT) {
-            flipper_pixel_set(0, i);
-            flipper_pixel_set(FL_LCD_WIDTH - 1, i);
-        }
-    }
+static void draw_border() {
+    flipper_draw_rect(0, 0, FL_LCD_WIDTH, FL_LCD_HEIGHT, FL_DRAW_OR);
 }
 
-void draw_x4(int x, int y) {
-    flipper_pixel_set(x, y);
-    flipper_pixel_set(x, y + 1);
-    flipper_pixel_set(x + 1, y);
-    flipper_pixel_set(x + 1, y + 1);
+static void draw_x4(int x, int y) {
+    flipper_draw_fill_rect(x, y, 2, 2, FL_DRAW_OR);
 }
 
-void fruit_new_pos(POINT* pos) {
+static void fruit_new_pos(POINT* pos) {
     do {
         pos->x = flipper_random(LCD_WIDTH2 - 2) * 2 + 2;
         pos->y = flipper_random(LCD_HEIGHT2 - 2) * 2 + 2;
     } while (flipper_pixel_get(pos->x, pos->y) || flipper_pixel_get(pos->x + 1, pos->y + 1));
 }
 
-bool fruit_check(POINT* fruit, POINT* snake) {
+static bool fruit_check(POINT* fruit, POINT* snake) {
     int dx = snake->x - fruit->x;
     int dy = snake->y - fruit->y;
     return (dx == 0 && dy == 0);
 }
 
-int get_latest_direction() {
+static int get_latest_direction() {
     int best_direction = -1;
     int best_time = 0;
 
@@ -169,6 +159,7 @@ int main() {
                 snake.grow = SNAKE_MAX_LEN;
             fruit_new_pos(&fruit_pos);
         }
+        flipper_set_score(snake.len);
 
         // draw fruit
         draw_x4(fruit_pos.x, fruit_pos.y);
@@ -177,5 +168,6 @@ int main() {
         flipper_lcd_constant_fps();
     }
 
+    flipper_close();
     return 0;
 }
\ No newline at end of file
@@ -1,8 +1,7 @@
 // https://tetris.fandom.com/wiki/Tetris_Guideline
 
 #include "flipper.h"
-#include "../img/micro4x6.xbm"
-#include <string.h>
+#include "tetris_game.h"
 
 #define GRID_X 7
 #define GRID_Y (24)
@@ -10,95 +9,54 @@
 #define GRID_SX 5
 #define GRID_SY 5
 
-#define GRID_WIDTH 10
-#define GRID_HEIGHT 20
-
 #define NEXT_Y -4
 
 #define FALL_DELAY 1000
 
-#include "tetris_pieces.h"
-
-enum GAME_STATE { PLAYING = 0, GAMEOVER };
-
-typedef struct {
-    int x;
-    int y;
-} POINT;
-
-typedef struct {
-    int piece;     // 0..NUM_PIECES-1
-    int rotation;  // 0..3
-    POINT position;
-} BLOCK;
-
-typedef struct {
-    BLOCK block;
-    int next_piece;
-    uint8_t field[GRID_HEIGHT][GRID_WIDTH];
-    int score;
-    int state;
-} GAME;
-
 #define BUTTONS 6
-int buttons[BUTTONS] = {
+static int buttons[BUTTONS] = {
     FL_GPIO_BUTTON_RIGHT, FL_GPIO_BUTTON_DOWN, FL_GPIO_BUTTON_LEFT,
     FL_GPIO_BUTTON_UP,    FL_GPIO_BUTTON_BACK, FL_GPIO_BUTTON_ENTER,
 };
 
-void game_init(GAME *g) {
-    g->block.position.x = 0;
-    g->block.position.y = 0;
-    g->block.piece = PIECE_L;
-    g->block.rotation = 0;
-    g->next_piece = flipper_random(NUM_PIECES);
-    g->score = 0;
-    g->state = PLAYING;
-    memset(g->field, 0, sizeof(g->field));
-}
+// round cell on the 5x5 grid: the pixels with 0 < dx * dx + dy * dy <= r2 around the
+// center. The cells are lcd sprites with the rotation already applied (x/y swapped), so
+// sprite column j is cell row j and bit i is cell column i.
+#define CELL_DIST(i, j) (((i) - 2) * ((i) - 2) + ((j) - 2) * ((j) - 2))
+#define CELL_BIT(i, j, r2) ((CELL_DIST(i, j) > 0 && CELL_DIST(i, j) <= (r2)) << (i))
+#define CELL_COLUMN(j, r2)                                                                \
+    (CELL_BIT(0, j, r2) | CELL_BIT(1, j, r2) | CELL_BIT(2, j, r2) | CELL_BIT(3, j, r2) | \
+     CELL_BIT(4, j, r2))
+#define CELL_SPRITE(r2)                                                                     \
+    {                                                                                       \
+        CELL_COLUMN(0, r2), CELL_COLUMN(1, r2), CELL_COLUMN(2, r2), CELL_COLUMN(3, r2), \
+            CELL_COLUMN(4, r2)                                                              \
+    }
 
-void game_rand_piece(GAME *g) {
-    g->block.piece = g->next_piece;
-    g->block.position.x = GRID_WIDTH / 2 - pieces[g->block.piece].width / 2;
-    g->block.position.y = -1;
-    g->block.rotation = 0;
-    g->next_piece = flipper_random(NUM_PIECES);
-}
+static const uint8_t cell_solid_data[GRID_SY] = CELL_SPRITE(6);
+static const uint8_t cell_shadow_data[GRID_SY] = CELL_SPRITE(4);
 
-// draw 1 pixel, swap x/y because rotated
-void draw_1(int x, int y) {
-    flipper_pixel_set(GRID_Y + y, GRID_X + x);
-}
+static const FLIPPER_SPRITE cell_solid = { GRID_SY, GRID_SX, cell_solid_data };
+static const FLIPPER_SPRITE cell_shadow = { GRID_SY, GRID_SX, cell_shadow_data };
 
-// round block on 5x5 grid
-void draw_5x5_circle(int x, int y, int radius2) {
-    if (radius2 == 0)
-        radius2 = 6;
-
-    for (int j = 0; j < 5; j++) {
-        for (int i = 0; i < 5; i++) {
-            int dx = i - 2;
-            int dy = j - 2;
-            int dist = dx * dx + dy * dy;
-            if (dist > 0 && dist <= radius2)
-                flipper_pixel_set(GRID_Y + y * GRID_SY + j, GRID_X + x * GRID_SX + i);
-        }
-    }
+#define FIELD_PAGES ((GRID_WIDTH * GRID_SX + 7) / 8)
+
+static void draw_cell(int x, int y, int is_shadow) {
+    flipper_draw_blit(GRID_Y + y * GRID_SY, GRID_X + x * GRID_SX,
+                      is_shadow ? &cell_shadow : &cell_solid, FL_DRAW_OR);
 }
 
-void draw_border() {
-    // field
-    for (int j = 0; j <= GRID_HEIGHT * GRID_SY; j++) {
-        draw_1(-1, j);
-        draw_1(GRID_WIDTH * GRID_SX, j);
-    }
-    for (int i = 0; i <= GRID_WIDTH * GRID_SX; i++) {
-        draw_1(i, -1);
-        draw_1(i, GRID_HEIGHT * (GRID_SY));
-    }
+static void draw_border() {
+    // field, swap x/y because rotated
+    int width = GRID_WIDTH * GRID_SX;
+    int height = GRID_HEIGHT * GRID_SY;
+    flipper_draw_hline(GRID_Y, GRID_X - 1, height + 1, FL_DRAW_OR);
+    flipper_draw_hline(GRID_Y, GRID_X + width, height + 1, FL_DRAW_OR);
+    flipper_draw_vline(GRID_Y - 1, GRID_X, width + 1, FL_DRAW_OR);
+    flipper_draw_vline(GRID_Y + height, GRID_X, width + 1, FL_DRAW_OR);
 }
 
-int get_latest_button() {
+static int get_latest_button() {
     int best_button = -1;
     int best_time = 0;
 
@@ -115,8 +73,8 @@ int get_latest_button() {
     return best_button;
 }
 
-void draw_block(BLOCK *b, int is_shadow) {
-    PIECE *p = &pieces[b->piece];
+static void draw_block(BLOCK *b, int is_shadow) {
+    const PIECE *p = &pieces[b->piece];
 
     for (int y = 0; y < p->height; y++) {
         for (int x = 0; x < p->width; x++) {
@@ -124,167 +82,96 @@ void draw_block(BLOCK *b, int is_shadow) {
                 continue;
             if (y + b->position.y < 0 || y + b->position.y > GRID_HEIGHT)
                 continue;
-            if (p->data[b->rotation][y * p->width + x]) {
-                draw_5x5_circle(b->position.x + x, b->position.y + y, is_shadow ? 4 : 0);
+            if (p->rows[b->rotation][y] & (1 << x)) {
+                draw_cell(b->position.x + x, b->position.y + y, is_shadow);
             }
         }
     }
 }
 
-void draw_next_piece(int next_type) {
-    PIECE *p = &pieces[next_type];
+static void draw_next_piece(int next_type) {
+    const PIECE *p = &pieces[next_type];
     int next_x = GRID_WIDTH - p->width - 1;
     for (int y = 0; y < p->height; y++) {
         for (int x = 0; x < p->width; x++) {
-            if (p->data[0][y * p->width + x]) {
-                draw_5x5_circle(next_x + x, NEXT_Y + y, 0);
+            if (p->rows[0][y] & (1 << x)) {
+                draw_cell(next_x + x, NEXT_Y + y, 0);
             }
         }
     }
 }
 
-bool valid_block(GAME *g, BLOCK *b) {
-    PIECE *p = &pieces[g->block.piece];
-    for (int y = 0; y < p->height; y++) {
-        for (int x = 0; x < p->width; x++) {
-            if (p->data[b->rotation][y * p->width + x]) {
-                if (b->position.x + x < 0 || b->position.x + x >= GRID_WIDTH)
-                    return false;
-                if (b->position.y + y >= GRID_HEIGHT)
-                    return false;
-                if (b->position.y + y < 0)
-                    continue;
-                if (g->field[b->position.y + y][b->position.x + x])
-                    return false;
-            }
-        }
-    }
-    return true;
-}
-
-void freeze_block_on_field(GAME *g) {
-    PIECE *p = &pieces[g->block.piece];
-    for (int y = 0; y < p->height; y++) {
-        for (int x = 0; x < p->width; x++) {
-            if (p->data[g->block.rotation][y * p->width + x]) {
-                if (g->block.position.y + y >= 0)
-                    g->field[g->block.position.y + y][g->block.position.x + x] = 1;
-            }
-        }
-    }
-
-    // find lines to be removed
-    int count = 0;
-    int lines[GRID_HEIGHT] = { 0 };
+// one blit per field row: the row's cells are combined into a sprite as 64 bit lcd columns
+static void draw_field(GAME *g) {
+    uint8_t data[FIELD_PAGES * GRID_SY];
+    FLIPPER_SPRITE row = { GRID_SY, GRID_WIDTH * GRID_SX, data };
 
     for (int y = 0; y < GRID_HEIGHT; y++) {
-        bool all = true;
-        for (int x = 0; x < GRID_WIDTH; x++) {
-            if (!g->field[y][x]) {
-                all = false;
-                break;
-            }
-        }
-        if (all) {
-            g->score++;
-            lines[y] = 1;
-            count++;
-        }
-    }
-    if (count == 0)
-        return;
-
-    // remove all tetris linescopy lines from above
-    int y_src = GRID_HEIGHT-1;
-    int y_dest = GRID_HEIGHT-1; 
-    while (y_src >= 0 && y_dest >= 0) {
-        while (y_src >= 0 && lines[y_src])
-            y_src--;
-        if (y_src < 0)
-            break;
+        if (!g->field[y])
+            continue;
 
-        if (y_dest != y_src)
-            memcpy(g->field[y_dest], g->field[y_src], GRID_WIDTH);
-        y_dest--;
-        y_src--;
-    }
-    for (int y=y_dest; y>=0; y--) {
-        memset(g->field[y], 0, GRID_WIDTH);
-    }
-}
-
-void draw_field(GAME *g) {
-    for (int y = 0; y < GRID_HEIGHT; y++) {
+        uint64_t columns[GRID_SY] = { 0 };
         for (int x = 0; x < GRID_WIDTH; x++) {
-            if (g->field[y][x]) {
-                draw_5x5_circle(x, y, 0);
+            if (g->field[y] & (1 << x)) {
+                for (int j = 0; j < GRID_SY; j++) {
+                    columns[j] |= (uint64_t)cell_solid_data[j] << (x * GRID_SX);
+                }
             }
         }
-    }
-}
 
-void draw_char(int x, int y, char c, int invert) {
-    if (c < 0 || c > 127)
-        return;
-    int py = (c / 16) * font_glyph_height;
-    int px = (c % 16) * font_glyph_width;
-
-    for (int j = 0; j < font_glyph_height; j++) {
-        for (int i = 0; i < font_glyph_width; i++) {
-            int yy = py + j;
-            int xx = px + i;
-            int bits = font_bits[yy * font_width / 8 + xx / 8];
-            if (((bits >> (xx & 7)) & 1) == invert)
-                flipper_pixel_set(y + j, x + i);
-            else
-                flipper_pixel_clear(y + j, x + i);
+        for (int p = 0; p < FIELD_PAGES; p++) {
+            for (int j = 0; j < GRID_SY; j++) {
+                data[p * GRID_SY + j] = (uint8_t)(columns[j] >> (p * 8));
+            }
         }
+        flipper_draw_blit(GRID_Y + y * GRID_SY, GRID_X, &row, FL_DRAW_OR);
     }
 }
 
-void draw_score(GAME *g) {
-    int score = g->score;
+static void draw_score(GAME *g) {
     // because rotated, use lcd height instead of width
-    int x = 1 + font_glyph_width * 2;
-    int y = 1;
-    do {
-        char c = '0' + (score % 10);
-        draw_char(x, y, c, 0);
-        x -= font_glyph_width;
-        score /= 10;
-    } while (score > 0);
+    flipper_text_draw_int(1 + FL_FONT_WIDTH * 3, 1, g->score, FL_TEXT_ROTATE);
 }
 
-void draw_string(int x, int y, char *s, int invert) {
-    while (*s) {
-        draw_char(x, y, *s, invert);
-        x += font_glyph_width;
-        s++;
-    }
+static void draw_box(int x, int y, int width, int height) {
+    flipper_draw_fill_rect(y, x, height, width, FL_DRAW_OR);
 }
 
-void draw_box(int x, int y, int width, int height) {
-    for (int j = 0; j < height; j++) {
-        for (int i = 0; i < width; i++) {
-            flipper_pixel_set(j + y, i + x);
-        }
-    }
-}
-
-// move down until stuck to find shadow position
-void find_shadow(GAME *g, BLOCK *b) {
-    BLOCK shadow = *b;
-    while (true) {
-        shadow.position.y++;
-        if (!valid_block(g, &shadow)) {
-            b->position.y = shadow.position.y - 1;
-            return;
+static void game_button(GAME *g, int *state, int *last_down_time, int button) {
+    BLOCK move_block = g->block;
+
+    if (button == FL_GPIO_BUTTON_BACK) {
+        game_init(g);
+        game_rand_piece(g);
+        *state = PLAYING;
+
+    } else if (*state == PLAYING) {
+        if (button == FL_GPIO_BUTTON_RIGHT) {
+            // RIGHT moves piece down until down
+            find_shadow(g, &g->block);
+            *last_down_time = 0;  // force new piece
+        } else {
+            // DOWN moves piece to the left
+            if (button == FL_GPIO_BUTTON_DOWN)
+                move_block.position.x--;
+
+            // UP moves piece to the right
+            if (button == FL_GPIO_BUTTON_UP)
+                move_block.position.x++;
+
+            // LEFT rotates
+            if (button == FL_GPIO_BUTTON_LEFT)
+                move_block.rotation = (move_block.rotation + 1) & 3;
+
+            if (valid_block(g, &move_block)) {
+                g->block = move_block;
+            }
         }
     }
 }
 
 int main() {
-    if (!flipper_init(FL_INIT_SIMULATOR_ROTATE))
+    if (!flipper_init(FL_INIT_SIMULATOR_ROTATE | FL_INIT_EVENTS))
         return 1;
 
     GAME g;
@@ -292,7 +179,6 @@ int main() {
     game_rand_piece(&g);
 
     bool quit = false;
-    int last_button = -1;
     int last_button_time = -1;
     int last_down_time = flipper_get_tics();
     int state = PLAYING;
@@ -305,47 +191,23 @@ int main() {
             break;
         }
 
-        int button = get_latest_button();
-        if (button != -1) {
-            int button_time = flipper_key_get_time(button);
-            int dt = flipper_get_tics() - last_button_time;
-
-            if (button != last_button || button_time != last_button_time || dt > 200) {
-                BLOCK move_block = g.block;
-
-                if (button == FL_GPIO_BUTTON_BACK) {
-                    game_init(&g);
-                    game_rand_piece(&g);
-                    state = PLAYING;
-
-                } else if (state == PLAYING) {
-                    if (button == FL_GPIO_BUTTON_RIGHT) {
-                        // RIGHT moves piece down until down
-                        find_shadow(&g, &g.block);
-                        last_down_time = 0;  // force new piece
-                    } else {
-                        // DOWN moves piece to the left
-                        if (button == FL_GPIO_BUTTON_DOWN)
-                            move_block.position.x--;
-
-                        // UP moves piece to the right
-                        if (button == FL_GPIO_BUTTON_UP)
-                            move_block.position.x++;
-
-                        // LEFT rotates
-                        if (button == FL_GPIO_BUTTON_LEFT)
-                            move_block.rotation = (move_block.rotation + 1) & 3;
-
-                        if (valid_block(&g, &move_block)) {
-                            g.block = move_block;
-                        }
-                    }
-                }
-                last_button = button;
-                last_button_time = button_time;
+        // every press acts once, even if the button was released again before this frame
+        bool pressed = false;
+        FLIPPER_EVENT event;
+        while (flipper_event_get(&event)) {
+            if (event.down) {
+                game_button(&g, &state, &last_down_time, event.pin);
+                last_button_time = flipper_get_tics();
+                pressed = true;
             }
         }
 
+        // the latest held button repeats after 200 ms
+        int button = get_latest_button();
+        if (!pressed && button != -1 && flipper_get_tics() - last_button_time > 200) {
+            game_button(&g, &state, &last_down_time, button);
+        }
+
         if (state == PLAYING) {
             if (flipper_get_tics() - last_down_time > FALL_DELAY) {
                 BLOCK new_block = g.block;
@@ -380,14 +242,16 @@ int main() {
             draw_next_piece(g.next_piece);
         }
         draw_score(&g);
+        flipper_set_score(g.score);
 
         if (state == GAMEOVER) {
             draw_box(16 - 2, 60 - 2, 39, 9);
-            draw_string(16, 60, "GAME OVER", 1);
+            flipper_text_draw(16, 60, "GAME OVER", FL_TEXT_ROTATE | FL_TEXT_INVERT);
         }
         flipper_lcd_update();
         flipper_lcd_constant_fps();
     }
 
+    flipper_close();
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,260 @@
+#include "tetris_bot.h"
+
+#include <SDL.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_PLACEMENTS (4 * (GRID_WIDTH + 3))
+
+#define DEFAULT_DEPTH 2
+
+typedef struct TETRIS_BOT_WORKER TETRIS_BOT_WORKER;
+struct TETRIS_BOT_WORKER {
+    TETRIS_BOT *bot;
+    SDL_Thread *thread;
+    uint64_t placements;
+};
+
+struct TETRIS_BOT {
+    TETRIS_HEURISTIC heuristic;
+    void *user;
+    int depth;
+
+    int num_workers;  // including the calling thread, workers[0]
+    TETRIS_BOT_WORKER *workers;
+    SDL_sem *start;
+    SDL_sem *done;
+    bool quit;
+
+    // the current search, placements are taken from next_move
+    const GAME *game;
+    int num_moves;
+    TETRIS_MOVE moves[MAX_PLACEMENTS];
+    SDL_atomic_t next_move;
+};
+
+static int count_bits(uint32_t v) {
+    int n = 0;
+    for (; v; v &= v - 1)
+        n++;
+    return n;
+}
+
+double tetris_bot_default_heuristic(const GAME *g, int lines, void *user) {
+    (void)user;
+    int heights[GRID_WIDTH] = { 0 };
+    int holes = 0;
+    uint32_t seen = 0;  // columns with a cell above the current row
+
+    for (int y = 0; y < GRID_HEIGHT; y++) {
+        uint32_t row = g->field[y];
+        uint32_t top = row & ~seen;
+        for (int x = 0; top; x++, top >>= 1) {
+            if (top & 1)
+                heights[x] = GRID_HEIGHT - y;
+        }
+        holes += count_bits(seen & ~row);
+        seen |= row;
+    }
+
+    int height = heights[0];
+    int bumpiness = 0;
+    for (int x = 1; x < GRID_WIDTH; x++) {
+        height += heights[x];
+        bumpiness += abs(heights[x] - heights[x - 1]);
+    }
+    return -0.510066 * height + 0.760666 * lines - 0.35663 * holes - 0.184483 * bumpiness;
+}
+
+// the block a new piece starts as, see game_rand_piece
+static void spawn(GAME *g, int piece) {
+    g->block.piece = piece;
+    g->block.position.x = GRID_WIDTH / 2 - pieces[piece].width / 2;
+    g->block.position.y = -1;
+    g->block.rotation = 0;
+}
+
+// all rotations and columns of g->block dropped down, rotations with the same cells as an
+// earlier one are skipped
+static int list_placements(const GAME *g, BLOCK *out) {
+    const PIECE *p = &pieces[g->block.piece];
+    int n = 0;
+    for (int r = 0; r < 4; r++) {
+        bool duplicate = false;
+        for (int i = 0; i < r && !duplicate; i++)
+            duplicate = memcmp(p->rows[i], p->rows[r], sizeof(p->rows[r])) == 0;
+        if (duplicate)
+            continue;
+
+        BLOCK b = g->block;
+        b.rotation = r;
+        for (b.position.x = -3; b.position.x < GRID_WIDTH; b.position.x++) {
+            if (!valid_block(g, &b))
+                continue;
+            out[n] = b;
+            find_shadow(g, &out[n]);
+            n++;
+        }
+    }
+    return n;
+}
+
+static double best_value(TETRIS_BOT *bot, const GAME *g, int depth, int lines,
+                         uint64_t *placements);
+
+// value of putting b into g with depth - 1 placements following
+static double placement_value(TETRIS_BOT *bot, const GAME *g, const BLOCK *b, int depth,
+                              int lines, uint64_t *placements) {
+    GAME next = *g;
+    next.block = *b;
+    freeze_block_on_field(&next);
+    lines += next.score - g->score;
+    (*placements)++;
+
+    if (depth == 1)
+        return bot->heuristic(&next, lines, bot->user);
+
+    if (next.next_piece >= 0) {
+        spawn(&next, next.next_piece);
+        next.next_piece = -1;
+        return best_value(bot, &next, depth - 1, lines, placements);
+    }
+
+    double sum = 0;
+    for (int piece = 0; piece < NUM_PIECES; piece++) {
+        spawn(&next, piece);
+        sum += best_value(bot, &next, depth - 1, lines, placements);
+    }
+    return sum / NUM_PIECES;
+}
+
+static double best_value(TETRIS_BOT *bot, const GAME *g, int depth, int lines,
+                         uint64_t *placements) {
+    BLOCK blocks[MAX_PLACEMENTS];
+    int n = list_placements(g, blocks);
+    double best = TETRIS_BOT_LOST;
+    for (int i = 0; i < n; i++) {
+        double value = placement_value(bot, g, &blocks[i], depth, lines, placements);
+        if (value > best)
+            best = value;
+    }
+    return best;
+}
+
+static void search(TETRIS_BOT_WORKER *worker) {
+    TETRIS_BOT *bot = worker->bot;
+    while (true) {
+        int i = SDL_AtomicAdd(&bot->next_move, 1);
+        if (i >= bot->num_moves)
+            break;
+        TETRIS_MOVE *move = &bot->moves[i];
+        move->score =
+            placement_value(bot, bot->game, &move->block, bot->depth, 0, &worker->placements);
+    }
+}
+
+static int worker_thread(void *data) {
+    TETRIS_BOT_WORKER *worker = (TETRIS_BOT_WORKER *)data;
+    TETRIS_BOT *bot = worker->bot;
+    while (true) {
+        SDL_SemWait(bot->start);
+        if (bot->quit)
+            break;
+        search(worker);
+        SDL_SemPost(bot->done);
+    }
+    return 0;
+}
+
+TETRIS_BOT *tetris_bot_create(int threads) {
+    if (threads <= 0)
+        threads = SDL_GetCPUCount();
+    if (threads < 1)
+        threads = 1;
+
+    TETRIS_BOT *bot = (TETRIS_BOT *)calloc(1, sizeof(TETRIS_BOT));
+    if (!bot)
+        return NULL;
+    bot->heuristic = tetris_bot_default_heuristic;
+    bot->depth = DEFAULT_DEPTH;
+    bot->workers = (TETRIS_BOT_WORKER *)calloc(threads, sizeof(TETRIS_BOT_WORKER));
+    bot->start = SDL_CreateSemaphore(0);
+    bot->done = SDL_CreateSemaphore(0);
+    if (!bot->workers || !bot->start || !bot->done) {
+        tetris_bot_destroy(bot);
+        return NULL;
+    }
+
+    bot->workers[0].bot = bot;
+    bot->num_workers = 1;
+    for (int i = 1; i < threads; i++) {
+        TETRIS_BOT_WORKER *worker = &bot->workers[i];
+        worker->bot = bot;
+        worker->thread = SDL_CreateThread(worker_thread, "tetris_bot", worker);
+        if (!worker->thread)
+            break;
+        bot->num_workers++;
+    }
+    return bot;
+}
+
+void tetris_bot_destroy(TETRIS_BOT *bot) {
+    if (!bot)
+        return;
+    bot->quit = true;
+    for (int i = 1; i < bot->num_workers; i++)
+        SDL_SemPost(bot->start);
+    for (int i = 1; i < bot->num_workers; i++)
+        SDL_WaitThread(bot->workers[i].thread, NULL);
+    if (bot->start)
+        SDL_DestroySemaphore(bot->start);
+    if (bot->done)
+        SDL_DestroySemaphore(bot->done);
+    free(bot->workers);
+    free(bot);
+}
+
+void tetris_bot_set_heuristic(TETRIS_BOT *bot, TETRIS_HEURISTIC heuristic, void *user) {
+    bot->heuristic = heuristic ? heuristic : tetris_bot_default_heuristic;
+    bot->user = user;
+}
+
+void tetris_bot_set_depth(TETRIS_BOT *bot, int depth) {
+    bot->depth = depth < 1 ? 1 : depth;
+}
+
+bool tetris_bot_best_move(TETRIS_BOT *bot, const GAME *g, TETRIS_MOVE *move) {
+    BLOCK blocks[MAX_PLACEMENTS];
+    int n = list_placements(g, blocks);
+    if (n == 0)
+        return false;
+
+    bot->game = g;
+    bot->num_moves = n;
+    for (int i = 0; i < n; i++)
+        bot->moves[i].block = blocks[i];
+    SDL_AtomicSet(&bot->next_move, 0);
+
+    // a single level is too little work to hand out
+    int helpers = bot->depth > 1 ? bot->num_workers - 1 : 0;
+    for (int i = 0; i < helpers; i++)
+        SDL_SemPost(bot->start);
+    search(&bot->workers[0]);
+    for (int i = 0; i < helpers; i++)
+        SDL_SemWait(bot->done);
+
+    int best = 0;
+    for (int i = 1; i < n; i++) {
+        if (bot->moves[i].score > bot->moves[best].score)
+            best = i;
+    }
+    *move = bot->moves[best];
+    return true;
+}
+
+uint64_t tetris_bot_get_placements(const TETRIS_BOT *bot) {
+    uint64_t placements = 0;
+    for (int i = 0; i < bot->num_workers; i++)
+        placements += bot->workers[i].placements;
+    return placements;
+}
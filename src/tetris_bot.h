@@ -0,0 +1,46 @@
+#pragma once
+
+// Placement search for tetris bots. Every rotation and column of the current block is
+// dropped straight down from the block's row, the resulting fields are rated by a heuristic
+// and the best placement is returned. With lookahead the placements of next_piece are
+// searched as well, deeper levels average over all pieces because they are not known yet.
+//
+// The placements of the current block are spread over a pool of worker threads. Results do
+// not depend on the number of threads, equal scores go to the first placement.
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "tetris_game.h"
+
+#define TETRIS_BOT_LOST -1e9  // score of a field where the next block can't be placed
+
+// rates g after a placement, higher is better. lines is the number of lines removed on the
+// way from the searched field to g.
+typedef double (*TETRIS_HEURISTIC)(const GAME *g, int lines, void *user);
+
+// aggregate height, lines, holes and bumpiness with the weights of Yiyuan Lee's genetic search
+double tetris_bot_default_heuristic(const GAME *g, int lines, void *user);
+
+typedef struct TETRIS_MOVE TETRIS_MOVE;
+struct TETRIS_MOVE {
+    BLOCK block;   // the current block at its final position
+    double score;  // best heuristic value reachable with this placement
+};
+
+typedef struct TETRIS_BOT TETRIS_BOT;
+
+// threads <= 0 uses one thread per cpu, 1 searches on the calling thread only
+TETRIS_BOT *tetris_bot_create(int threads);
+void tetris_bot_destroy(TETRIS_BOT *bot);
+
+void tetris_bot_set_heuristic(TETRIS_BOT *bot, TETRIS_HEURISTIC heuristic, void *user);
+// placements per search: 1 only the current block, 2 also next_piece (default), more adds
+// levels of unknown pieces
+void tetris_bot_set_depth(TETRIS_BOT *bot, int depth);
+
+// false if the current block can't be placed anywhere
+bool tetris_bot_best_move(TETRIS_BOT *bot, const GAME *g, TETRIS_MOVE *move);
+
+// placements rated since tetris_bot_create
+uint64_t tetris_bot_get_placements(const TETRIS_BOT *bot);
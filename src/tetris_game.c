@@ -0,0 +1,88 @@
+#include "tetris_game.h"
+
+#include <string.h>
+
+#include "flipper.h"
+
+void game_init(GAME *g) {
+    g->block.position.x = 0;
+    g->block.position.y = 0;
+    g->block.piece = PIECE_L;
+    g->block.rotation = 0;
+    g->next_piece = flipper_random(NUM_PIECES);
+    g->score = 0;
+    g->state = PLAYING;
+    memset(g->field, 0, sizeof(g->field));
+}
+
+void game_rand_piece(GAME *g) {
+    g->block.piece = g->next_piece;
+    g->block.position.x = GRID_WIDTH / 2 - pieces[g->block.piece].width / 2;
+    g->block.position.y = -1;
+    g->block.rotation = 0;
+    g->next_piece = flipper_random(NUM_PIECES);
+}
+
+uint32_t block_row(const BLOCK *b, int y) {
+    uint32_t row = pieces[b->piece].rows[b->rotation][y];
+    int x = b->position.x;
+    if (x >= 0)
+        return row << x;
+    // cells left of the field
+    if (row & ((1u << -x) - 1))
+        return ~0u;
+    return row >> -x;
+}
+
+bool valid_block(const GAME *g, const BLOCK *b) {
+    const PIECE *p = &pieces[b->piece];
+    for (int y = 0; y < p->height; y++) {
+        uint32_t row = block_row(b, y);
+        if (!row)
+            continue;
+        if (row & ~FULL_ROW)
+            return false;
+        if (b->position.y + y >= GRID_HEIGHT)
+            return false;
+        if (b->position.y + y < 0)
+            continue;
+        if (g->field[b->position.y + y] & row)
+            return false;
+    }
+    return true;
+}
+
+void find_shadow(const GAME *g, BLOCK *b) {
+    BLOCK shadow = *b;
+    while (true) {
+        shadow.position.y++;
+        if (!valid_block(g, &shadow)) {
+            b->position.y = shadow.position.y - 1;
+            return;
+        }
+    }
+}
+
+void freeze_block_on_field(GAME *g) {
+    const PIECE *p = &pieces[g->block.piece];
+    for (int y = 0; y < p->height; y++) {
+        // empty rows of the piece box may hang below the floor
+        uint32_t row = block_row(&g->block, y);
+        int field_y = g->block.position.y + y;
+        if (row && field_y >= 0 && field_y < GRID_HEIGHT)
+            g->field[field_y] |= row;
+    }
+
+    // remove full lines, the rows above move down
+    int y_dest = GRID_HEIGHT - 1;
+    for (int y = GRID_HEIGHT - 1; y >= 0; y--) {
+        if (g->field[y] == FULL_ROW) {
+            g->score++;
+            continue;
+        }
+        g->field[y_dest--] = g->field[y];
+    }
+    while (y_dest >= 0) {
+        g->field[y_dest--] = 0;
+    }
+}
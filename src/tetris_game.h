@@ -0,0 +1,48 @@
+#pragma once
+
+// Tetris rules without drawing or input, shared by the game and the placement search.
+// The field is a bitboard: one mask per row, bit x is column x.
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "tetris_pieces.h"
+
+#define GRID_WIDTH 10
+#define GRID_HEIGHT 20
+
+#define FULL_ROW ((1 << GRID_WIDTH) - 1)
+
+enum GAME_STATE { PLAYING = 0, GAMEOVER };
+
+typedef struct {
+    int x;
+    int y;
+} POINT;
+
+typedef struct {
+    int piece;     // 0..NUM_PIECES-1
+    int rotation;  // 0..3
+    POINT position;
+} BLOCK;
+
+typedef struct {
+    BLOCK block;
+    int next_piece;
+    uint16_t field[GRID_HEIGHT];  // bit x is column x
+    int score;
+    int state;
+} GAME;
+
+void game_init(GAME *g);
+// next_piece becomes the block at the top of the field, uses flipper_random
+void game_rand_piece(GAME *g);
+
+// piece row y of b moved to its field columns, bits outside the field end up above FULL_ROW
+uint32_t block_row(const BLOCK *b, int y);
+
+bool valid_block(const GAME *g, const BLOCK *b);
+// move b down until stuck
+void find_shadow(const GAME *g, BLOCK *b);
+// put g->block into the field and remove full lines, each line adds one to the score
+void freeze_block_on_field(GAME *g);
@@ -0,0 +1,175 @@
+#include "tetris_pieces.h"
+
+// clang-format off
+const PIECE pieces[NUM_PIECES] = {
+// I
+    { 4, 4, {
+        {
+            ROW4(0,0,0,0),
+            ROW4(1,1,1,1),
+            ROW4(0,0,0,0),
+            ROW4(0,0,0,0),
+        },
+        {
+            ROW4(0,0,1,0),
+            ROW4(0,0,1,0),
+            ROW4(0,0,1,0),
+            ROW4(0,0,1,0),
+        },
+        {
+            ROW4(0,0,0,0),
+            ROW4(0,0,0,0),
+            ROW4(1,1,1,1),
+            ROW4(0,0,0,0),
+        },
+        {
+            ROW4(0,1,0,0),
+            ROW4(0,1,0,0),
+            ROW4(0,1,0,0),
+            ROW4(0,1,0,0),
+        },
+    } },
+// O
+    { 4, 4, {
+        {
+            ROW4(0,0,0,0),
+            ROW4(0,1,1,0),
+            ROW4(0,1,1,0),
+            ROW4(0,0,0,0),
+        },
+        {
+            ROW4(0,0,0,0),
+            ROW4(0,1,1,0),
+            ROW4(0,1,1,0),
+            ROW4(0,0,0,0),
+        },
+        {
+            ROW4(0,0,0,0),
+            ROW4(0,1,1,0),
+            ROW4(0,1,1,0),
+            ROW4(0,0,0,0),
+        },
+        {
+            ROW4(0,0,0,0),
+            ROW4(0,1,1,0),
+            ROW4(0,1,1,0),
+            ROW4(0,0,0,0),
+        },
+    } },
+// L
+    { 3, 3, {
+        {
+            ROW3(1,0,0),
+            ROW3(1,1,1),
+            ROW3(0,0,0),
+        },
+        {
+            ROW3(0,1,1),
+            ROW3(0,1,0),
+            ROW3(0,1,0),
+        },
+        {
+            ROW3(0,0,0),
+            ROW3(1,1,1),
+            ROW3(0,0,1),
+        },
+        {
+            ROW3(0,1,0),
+            ROW3(0,1,0),
+            ROW3(1,1,0),
+        },
+    } },
+// L2
+    { 3, 3, {
+        {
+            ROW3(0,0,1),
+            ROW3(1,1,1),
+            ROW3(0,0,0),
+        },
+        {
+            ROW3(0,1,0),
+            ROW3(0,1,0),
+            ROW3(0,1,1),
+        },
+        {
+            ROW3(0,0,0),
+            ROW3(1,1,1),
+            ROW3(1,0,0),
+        },
+        {
+            ROW3(1,1,0),
+            ROW3(0,1,0),
+            ROW3(0,1,0),
+        },
+    } },
+// S
+    { 3, 3, {
+        {
+            ROW3(0,1,1),
+            ROW3(1,1,0),
+            ROW3(0,0,0),
+        },
+        {
+            ROW3(0,1,0),
+            ROW3(0,1,1),
+            ROW3(0,0,1),
+        },
+        {
+            ROW3(0,0,0),
+            ROW3(0,1,1),
+            ROW3(1,1,0),
+        },
+        {
+            ROW3(1,0,0),
+            ROW3(1,1,0),
+            ROW3(0,1,0),
+        },
+    } },
+// S2
+    { 3, 3, {
+        {
+            ROW3(1,1,0),
+            ROW3(0,1,1),
+            ROW3(0,0,0),
+        },
+        {
+            ROW3(0,0,1),
+            ROW3(0,1,1),
+            ROW3(0,1,0),
+        },
+        {
+            ROW3(0,0,0),
+            ROW3(1,1,0),
+            ROW3(0,1,1),
+        },
+        {
+            ROW3(0,1,0),
+            ROW3(1,1,0),
+            ROW3(1,0,0),
+        },
+    } },
+// T
+    { 3, 3, {
+        {
+            ROW3(0,1,0),
+            ROW3(1,1,1),
+            ROW3(0,0,0),
+        },
+        {
+            ROW3(0,1,0),
+            ROW3(0,1,1),
+            ROW3(0,1,0),
+        },
+        {
+            ROW3(0,0,0),
+            ROW3(1,1,1),
+            ROW3(0,1,0),
+        },
+        {
+            ROW3(0,1,0),
+            ROW3(1,1,0),
+            ROW3(0,1,0),
+        },
+    } },
+};
+// clang-format on
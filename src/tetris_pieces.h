@@ -1,190 +1,20 @@
 #pragma once
 
+#include <stdint.h>
+
 typedef struct PIECE PIECE;
 struct PIECE {
     int width, height;
-    uint8_t data[4][4 * 4];
+    uint16_t rows[4][4];  // per rotation one mask per row, bit x is column x
 };
 
+// row masks from the cells of a row, written left to right
+#define ROW3(a, b, c) ((a) | (b) << 1 | (c) << 2)
+#define ROW4(a, b, c, d) ((a) | (b) << 1 | (c) << 2 | (d) << 3)
+
 #define NUM_PIECES 7
 // I O L L2 S S2 T
 
 enum { PIECE_I = 0, PIECE_O, PIECE_L, PIECE_L2, PIECE_S, PIECE_S2, PIECE_T };
 
-// clang-format off
-PIECE pieces[NUM_PIECES] = {
-// I
-    { 4, 4, { 
-        {
-            0,0,0,0,
-            1,1,1,1,
-            0,0,0,0,
-            0,0,0,0,
-        },
-        {
-            0,0,1,0,
-            0,0,1,0,
-            0,0,1,0,
-            0,0,1,0,
-        },
-        {
-            0,0,0,0,
-            0,0,0,0,
-            1,1,1,1,
-            0,0,0,0,
-        },
-        {
-            0,1,0,0,
-            0,1,0,0,
-            0,1,0,0,
-            0,1,0,0,
-        },
-    } },
-// O
-    { 4, 4, { 
-        {
-            0,0,0,0,
-            0,1,1,0,
-            0,1,1,0,
-            0,0,0,0,
-        },
-        {
-            0,0,0,0,
-            0,1,1,0,
-            0,1,1,0,
-            0,0,0,0,
-        },
-        {
-            0,0,0,0,
-            0,1,1,0,
-            0,1,1,0,
-            0,0,0,0,
-        },
-        {
-            0,0,0,0,
-            0,1,1,0,
-            0,1,1,0,
-            0,0,0,0,
-        },
-    } },
-// L
-    { 3, 3, { 
-        {
-            1,0,0,
-            1,1,1,
-            0,0,0,
-        },
-        {
-            0,1,1,
-            0,1,0,
-            0,1,0,
-        },
-        {
-            0,0,0,
-            1,1,1,
-            0,0,1,
-        },
-        {
-            0,1,0,
-            0,1,0,
-            1,1,0,
-        },
-    } },
-    
-    // L2
-    { 3, 3, {
-        {
-            0,0,1,
-            1,1,1,
-            0,0,0,
-        },
-        {
-            0,1,0,
-            0,1,0,
-            0,1,1,
-        },
-        {
-            0,0,0,
-            1,1,1,
-            1,0,0,
-        },
-        {
-            1,1,0,
-            0,1,0,
-            0,1,0,
-        },
-    } },
-    
-    // S
-    { 3, 3, {
-        {
-            0,1,1,
-            1,1,0,
-            0,0,0,
-        },
-        {
-            0,1,0,
-            0,1,1,
-            0,0,1,
-        },
-        {
-            0,0,0,
-            0,1,1,
-            1,1,0,
-        },
-        {
-            1,0,0,
-            1,1,0,
-            0,1,0,
-        },
-    } },
-    
-    // S2
-    { 3, 3, {
-        {
-            1,1,0,
-            0,1,1,
-            0,0,0,
-        },
-        {
-            0,0,1,
-            0,1,1,
-            0,1,0,
-        },
-        {
-            0,0,0,
-            1,1,0,
-            0,1,1,
-        },
-        {
-            0,1,0,
-            1,1,0,
-            1,0,0,
-        },
-    } },
-    
-    // T
-    { 3, 3, {
-        {
-            0,1,0,
-            1,1,1,
-            0,0,0,
-        },
-        {
-            0,1,0,
-            0,1,1,
-            0,1,0,
-        },
-        {
-            0,0,0,
-            1,1,1,
-            0,1,0,
-        },
-        {
-            0,1,0,
-            1,1,0,
-            0,1,0,
-        },
-    } },
-};
-// clang-format on
+extern const PIECE pieces[NUM_PIECES];
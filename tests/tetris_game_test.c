@@ -0,0 +1,75 @@
+// Checks of the tetris rules, returns 1 if any fails.
+
+#include <stdio.h>
+
+#include "tetris_game.h"
+
+static int failed;
+
+#define CHECK(cond)                                                   \
+    do {                                                             \
+        if (!(cond)) {                                               \
+            printf("%s:%d: %s failed\n", __FILE__, __LINE__, #cond); \
+            failed = 1;                                              \
+        }                                                            \
+    } while (0)
+
+// a block frozen at the floor must not write past field[GRID_HEIGHT - 1] into the GAME fields
+// after it
+static void drop_to_floor(int rotation, int x, uint16_t bottom, int height) {
+    GAME g;
+    game_init(&g);
+    g.score = 0;
+    g.state = PLAYING;
+    g.next_piece = PIECE_O;
+    g.block.piece = PIECE_I;
+    g.block.rotation = rotation;
+    g.block.position.x = x;
+    g.block.position.y = -1;
+
+    find_shadow(&g, &g.block);
+    freeze_block_on_field(&g);
+
+    for (int y = 0; y < GRID_HEIGHT - height; y++) {
+        CHECK(g.field[y] == 0);
+    }
+    for (int y = GRID_HEIGHT - height; y < GRID_HEIGHT; y++) {
+        CHECK(g.field[y] == bottom);
+    }
+    CHECK(g.score == 0);
+    CHECK(g.state == PLAYING);
+    CHECK(g.next_piece == PIECE_O);
+}
+
+// an I into the gap of three almost full rows, resting on a bottom row with another gap
+static void clear_lines() {
+    GAME g;
+    game_init(&g);
+    for (int y = GRID_HEIGHT - 4; y < GRID_HEIGHT - 1; y++) {
+        g.field[y] = FULL_ROW & ~1;
+    }
+    g.field[GRID_HEIGHT - 1] = FULL_ROW & ~2;
+    g.block.piece = PIECE_I;
+    g.block.rotation = 3;  // column 1 of the box
+    g.block.position.x = -1;
+    g.block.position.y = -1;
+
+    find_shadow(&g, &g.block);
+    CHECK(g.block.position.y == GRID_HEIGHT - 5);
+    freeze_block_on_field(&g);
+    CHECK(g.score == 3);
+    CHECK(g.field[GRID_HEIGHT - 1] == (FULL_ROW & ~2));
+    CHECK(g.field[GRID_HEIGHT - 2] == 1);
+    CHECK(g.field[GRID_HEIGHT - 3] == 0);
+}
+
+int main() {
+    drop_to_floor(0, 0, 0xf, 1);
+    drop_to_floor(2, 6, 0xf << 6, 1);
+    drop_to_floor(1, 0, 1 << 2, 4);
+    drop_to_floor(3, -1, 1, 4);
+    clear_lines();
+    if (!failed)
+        printf("tetris_game_test: ok\n");
+    return failed;
+}